@@ -0,0 +1,101 @@
+#include "main.h"
+#include "restaurant.h"
+
+// Counts heap allocations made while simulate processes commands on a warmed-up
+// restaurant. Parsing, dispatch and the query and eviction commands must not
+// allocate at all, on empty or populated structures; an admitted LAPSE may only
+// allocate what it stores (the customer and its place in Gojo or Sukuna).
+//
+// Run: alloc   (make test runs the release build; ASan replaces operator new)
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) throw bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+// Rounds run before counting starts, so the structures settle into a steady
+// state and the result buffers reach their final size
+static const int settleRounds = 10;
+
+// Allocations made by simulate for input, which runs repeat times. refill runs
+// before each repeat without being counted.
+static size_t countAllocations(restaurant* res, string_view input, int repeat = 1, string_view refill = {}) {
+    ostream discard(nullptr);
+    size_t counted = 0;
+    for (int i = -settleRounds; i < repeat; i++) {
+        simulate(res, refill, discard);
+        size_t before = allocations;
+        simulate(res, input, discard);
+        if (i >= 0) counted += allocations - before;
+    }
+    return counted;
+}
+
+struct check {
+    const char* name;
+    const char* input;
+    int repeat;
+    size_t limit;        // Allowed allocations over all repeats
+    const char* setup;   // Uncounted, run once before the check
+    const char* refill;  // Uncounted, run before every repeat
+};
+
+// Five customers in Gojo's bucket 4 and three in Sukuna's areas 1 and 3, for MAXSIZE 4
+static const char* populate =
+    "LAPSE aabbbcccc\n"
+    "LAPSE xyzxyzzzw\n"
+    "LAPSE qqqwwweer\n"
+    "LAPSE mmnnoopqq\n"
+    "LAPSE helloworld\n"
+    "LAPSE abcdefgh\n"
+    "LAPSE abcdefghij\n"
+    "LAPSE abcdefgh\n";
+
+int main() {
+    restaurant* res = new restaurant;
+    // Fills both halves, renders HAND once and traces every name used below, so
+    // the Huffman cache, the HAND text and the stream buffers are all warm
+    const char* warmUp =
+        "MAXSIZE 4\n"
+        "LAPSE abcdefgh\n"
+        "LAPSE abcdefghij\n"
+        "LAPSE aab\n"
+        "HAND\n"
+        "KOKUSEN\n"
+        "KEITEIKEN 4\n"
+        "LIMITLESS 1\n"
+        "CLEAVE 3\n";
+    countAllocations(res, warmUp);
+    int failed = 0;
+    const check checks[] = {
+        {"rejected LAPSE", "LAPSE aab\n", 100, 0},
+        {"HAND", "HAND\n", 100, 0},
+        {"LIMITLESS on an empty bucket", "LIMITLESS 1\n", 100, 0},
+        {"KEITEIKEN on an empty heap", "KEITEIKEN 2\n", 100, 0},
+        {"CLEAVE on an empty heap", "CLEAVE 2\n", 100, 0},
+        {"KOKUSEN on empty buckets", "KOKUSEN\n", 100, 0},
+        {"mixed read-only stream", "HAND\nLAPSE aab\nHAND\nLIMITLESS 2\n", 100, 0},
+        {"admitted LAPSE, cached Huffman tree", "LAPSE abcdefgh\nLAPSE abcdefghij\n", 100, 2 * 2 * 100},
+        {"LIMITLESS on a populated bucket", "LIMITLESS 4\n", 100, 0, populate},
+        {"CLEAVE on a populated heap", "CLEAVE 5\n", 100, 0},
+        // Bucket 4 settles at five customers with one evicted per KOKUSEN
+        {"KOKUSEN on a populated bucket", "KOKUSEN\n", 100, 0, nullptr, "LAPSE helloworld\n"},
+        {"KEITEIKEN on a populated heap", "KEITEIKEN 4\n", 100, 0, nullptr, "LAPSE abcdefgh\nLAPSE abcdefghij\nLAPSE abcdefgh\n"},
+    };
+    ostream discard(nullptr);
+    for (auto& c : checks) {
+        if (c.setup) simulate(res, c.setup, discard);
+        size_t n = countAllocations(res, c.input, c.repeat, c.refill ? c.refill : "");
+        bool ok = n <= c.limit;
+        cout << (ok ? "ok   " : "FAIL ") << c.name << ": " << n << " allocations over " << c.repeat << " runs (limit " << c.limit << ")\n";
+        if (!ok) failed++;
+    }
+    destroy(res);
+    return failed ? 1 : 0;
+}
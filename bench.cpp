@@ -0,0 +1,666 @@
+#include <pthread.h>
+
+#include "main.h"
+#include "restaurant.h"
+
+// Benchmarks for the restaurant engine.
+// Build: make release (or make debug / make pgo), binary in build/<flavour>/bench
+
+typedef chrono::steady_clock benchClock;
+
+static double elapsedMs(benchClock::time_point start) {
+    return chrono::duration<double, milli>(benchClock::now() - start).count();
+}
+
+// Recursive versions of the traversals, kept only as a baseline to compare against
+namespace recursive {
+void postorderTraversal(hashBST::BSTNode* root, vector<int>& result) {
+    if (root == NULL) return;
+    postorderTraversal(root->left, result);
+    postorderTraversal(root->right, result);
+    result.push_back(root->result);
+}
+
+void inorderTraversal(hashBST::BSTNode* root, vector<int>& result) {
+    if (root == nullptr) return;
+    inorderTraversal(root->left, result);
+    result.push_back(root->result);
+    inorderTraversal(root->right, result);
+}
+
+void removeTree(hashBST::BSTNode*& root) {
+    if (root == nullptr) return;
+    removeTree(root->left);
+    removeTree(root->right);
+    destroy(root);
+}
+
+void getInorderTree(HuffNode* root, handCode& result) {
+    if (root == nullptr) return;
+    getInorderTree(root->left(), result);
+    if (root->isLeaf()) {
+        result.leaf(root->val());
+    } else {
+        result.internal(root->weight());
+    }
+    getInorderTree(root->right(), result);
+}
+
+void removeHuffTree(HuffNode* node) {
+    if (node) {
+        removeHuffTree(node->left());
+        removeHuffTree(node->right());
+        destroy(node);
+    }
+}
+}  // namespace recursive
+
+// Right-leaning chain, the shape a bucket takes when Results arrive in increasing order
+static hashBST::BSTNode* skewedBST(int n) {
+    hashBST::BSTNode* root = nullptr;
+    for (int i = n - 1; i >= 0; i--) {
+        hashBST::BSTNode* node = new hashBST::BSTNode{i, nullptr, root};
+        if (root != nullptr) root->parent = node;
+        root = node;
+    }
+    return root;
+}
+
+// Left-leaning Huffman tree of depth n
+static HuffTree* skewedHuffTree(int n) {
+    char c = 'a';
+    HuffTree* tree = new HuffTree(c, 1, 0);
+    for (int i = 1; i < n; i++) {
+        HuffTree leaf(c, 1, i);
+        tree->setRoot(new IntlNode(tree->root(), leaf.root(), nullptr));
+    }
+    return tree;
+}
+
+// The recursive baselines need a deep stack for 10^6 nodes
+static void runWithStack(void (*fn)(void*), void* arg, size_t stackSize) {
+    struct job {
+        void (*fn)(void*);
+        void* arg;
+        static void* run(void* p) {
+            job* j = static_cast<job*>(p);
+            j->fn(j->arg);
+            return nullptr;
+        }
+    } j{fn, arg};
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stackSize);
+    pthread_t th;
+    pthread_create(&th, &attr, &job::run, &j);
+    pthread_join(th, nullptr);
+    pthread_attr_destroy(&attr);
+}
+
+struct traversalBench {
+    int n;
+    bool useRecursive;
+    double postorderMs, inorderMs, removeTreeMs, huffInorderMs, removeHuffMs;
+};
+
+static void runTraversals(void* arg) {
+    traversalBench* b = static_cast<traversalBench*>(arg);
+    hashBST table(1);
+    hashBST::BSTTree bucket;
+
+    hashBST::BSTNode* root = skewedBST(b->n);
+    vector<int> list;
+    list.reserve(b->n);
+    benchClock::time_point start = benchClock::now();
+    b->useRecursive ? recursive::postorderTraversal(root, list) : table.postorderTraversal(root, list);
+    b->postorderMs = elapsedMs(start);
+
+    list.clear();
+    start = benchClock::now();
+    b->useRecursive ? recursive::inorderTraversal(root, list) : table.inorderTraversal(root, list);
+    b->inorderMs = elapsedMs(start);
+
+    start = benchClock::now();
+    b->useRecursive ? recursive::removeTree(root) : bucket.removeTree(root);
+    b->removeTreeMs = elapsedMs(start);
+
+    HuffTree* tree = skewedHuffTree(b->n);
+    handCode inorder;
+    start = benchClock::now();
+    b->useRecursive ? recursive::getInorderTree(tree->root(), inorder) : tree->getInorderTree(tree->root(), inorder);
+    b->huffInorderMs = elapsedMs(start);
+
+    start = benchClock::now();
+    b->useRecursive ? recursive::removeHuffTree(tree->root()) : tree->removeHuffTree(tree->root());
+    b->removeHuffMs = elapsedMs(start);
+    destroy(tree);
+}
+
+static void benchTraversals(int n) {
+    traversalBench rec = {n, true, 0, 0, 0, 0, 0};
+    traversalBench ite = {n, false, 0, 0, 0, 0, 0};
+    runWithStack(runTraversals, &rec, (size_t)1 << 30);
+    runWithStack(runTraversals, &ite, (size_t)1 << 20);
+    cout << "degenerate traversals, n = " << n << " (ms, recursive vs iterative)\n";
+    cout << "  postorderTraversal  " << rec.postorderMs << "\t" << ite.postorderMs << "\n";
+    cout << "  inorderTraversal    " << rec.inorderMs << "\t" << ite.inorderMs << "\n";
+    cout << "  removeTree          " << rec.removeTreeMs << "\t" << ite.removeTreeMs << "\n";
+    cout << "  getInorderTree      " << rec.huffInorderMs << "\t" << ite.huffInorderMs << "\n";
+    cout << "  removeHuffTree      " << rec.removeHuffMs << "\t" << ite.removeHuffMs << "\n";
+}
+
+static string randomName(mt19937& rng, int length, int alphabet = 52) {
+    static const char alpha[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    string name(length, 'a');
+    for (auto& c : name) c = alpha[rng() % alphabet];
+    return name;
+}
+
+// Time to destroy a restaurant holding n customers, freeing inline vs through the reclaimer
+static void benchTeardown(int n) {
+    double ms[2];
+    for (int bulk = 0; bulk < 2; bulk++) {
+        mt19937 rng(1);
+        restaurant* res = new restaurant(bulk);
+        res->setMAXSIZE(64);
+        for (int i = 0; i < n; i++) res->LAPSE(randomName(rng, 20));
+        benchClock::time_point start = benchClock::now();
+        destroy(res);
+        ms[bulk] = elapsedMs(start);
+    }
+    cout << "teardown, n = " << n << " LAPSE (ms, inline vs bulk release)\n";
+    cout << "  ~restaurant         " << ms[0] << "\t" << ms[1] << "\n";
+}
+
+// Gojo eviction as it was before FIFO entries held node handles: pop a Result,
+// search the BST for it and copy the successor's Result up. Baseline only.
+namespace byValue {
+void insert(hashBST::BSTNode*& root, int result) {
+    hashBST::BSTNode** link = &root;
+    while (*link != nullptr) {
+        link = (result < (*link)->result) ? &(*link)->left : &(*link)->right;
+    }
+    *link = new hashBST::BSTNode{result, nullptr, nullptr, nullptr, nullptr};
+}
+
+void remove(hashBST::BSTNode*& root, int result) {
+    hashBST::BSTNode** link = &root;
+    while (*link != nullptr && (*link)->result != result) {
+        link = (result < (*link)->result) ? &(*link)->left : &(*link)->right;
+    }
+    hashBST::BSTNode* node = *link;
+    if (node == nullptr) return;
+    if (node->left == nullptr || node->right == nullptr) {
+        *link = node->left ? node->left : node->right;
+        destroy(node);
+        return;
+    }
+    hashBST::BSTNode** succ = &node->right;
+    while ((*succ)->left != nullptr) {
+        succ = &(*succ)->left;
+    }
+    hashBST::BSTNode* temp = *succ;
+    node->result = temp->result;
+    *succ = temp->right;
+    destroy(temp);
+}
+}  // namespace byValue
+
+// KOKUSEN-style evictions of n/100 customers at a time from one bucket of n whose
+// Results take only distinct values, by value search vs through node handles
+static void benchEvict(int n, int distinct) {
+    mt19937 rng(1);
+    vector<int> results(n);
+    for (auto& r : results) r = rng() % distinct;
+    int step = max(1, n / 100);
+
+    benchClock::time_point start = benchClock::now();
+    hashBST::BSTNode* root = nullptr;
+    for (int r : results) byValue::insert(root, r);
+    double insertMs = elapsedMs(start);
+    start = benchClock::now();
+    for (int i = 0; i < n; i++) byValue::remove(root, results[i]);
+    double valueMs = elapsedMs(start);
+
+    hashBST table(1);
+    start = benchClock::now();
+    for (int r : results) {
+        customer* cus = new customer;
+        cus->Result = r;
+        table.insert(cus);
+    }
+    double handleInsertMs = elapsedMs(start);
+    vector<served> evicted;
+    start = benchClock::now();
+    for (int left = n; left > 0; left -= step) {
+        table.remove(1, step, evicted);
+    }
+    double handleMs = elapsedMs(start);
+    cout << "  " << distinct << " distinct        " << insertMs << "\t" << handleInsertMs << "\t" << valueMs << "\t" << handleMs << "\n";
+}
+
+// Sukuna's heap as it was before keys moved inline: a binary heap of pointers
+// that reads num and time through each separately allocated area. Baseline only.
+class pointerHeap {
+   private:
+    struct area {
+        int label;
+        int num;
+        int time;
+        ringQueue<customer*> q;
+    };
+    vector<area*> table;
+    vector<int> slot;
+    int time;
+
+    void swapSlots(int i, int j) {
+        swap(table[i], table[j]);
+        slot[table[i]->label] = i;
+        slot[table[j]->label] = j;
+    }
+
+   public:
+    pointerHeap(int n) : table(1), slot(n, 0), time(0) {}
+    ~pointerHeap() {
+        for (unsigned int i = 1; i < table.size(); i++) {
+            while (!table[i]->q.empty()) {
+                destroy(table[i]->q.front());
+                table[i]->q.pop();
+            }
+            destroy(table[i]);
+        }
+    }
+
+    void insert(customer* cus) {
+        int label = cus->Result;
+        int i = slot[label];
+        if (i != 0) {
+            table[i]->num++;
+            table[i]->time = time++;
+            table[i]->q.push(cus);
+            int size = table.size() - 1;
+            while (true) {
+                int left = i * 2, right = i * 2 + 1;
+                if (left > size) return;
+                int min = left;
+                if (right <= size && (table[right]->num < table[left]->num || (table[right]->num == table[left]->num && table[right]->time < table[left]->time))) min = right;
+                if (table[i]->num < table[min]->num || (table[i]->num == table[min]->num && table[i]->time < table[min]->time)) return;
+                swapSlots(i, min);
+                i = min;
+            }
+        }
+        area* a = new area;
+        a->label = label;
+        a->num = 1;
+        a->time = time++;
+        a->q.push(cus);
+        table.push_back(a);
+        i = table.size() - 1;
+        slot[label] = i;
+        while (i > 1 && table[i]->num < table[i / 2]->num) {
+            swapSlots(i, i / 2);
+            i /= 2;
+        }
+    }
+};
+
+// Build n areas, then 2n inserts into random existing areas (each a sift down),
+// for the pointer baseline and minHeap at arity 2, 4 and 8
+static void benchHeap(int n) {
+    mt19937 rng(1);
+    vector<int> labels(2 * n);
+    for (auto& label : labels) label = rng() % n;
+    double ms[4];
+    int arity[] = {0, 2, 4, 8};  // 0 is the pointer baseline
+    for (int k = 0; k < 4; k++) {
+        vector<customer*> customers(3 * n);
+        for (int i = 0; i < 3 * n; i++) {
+            customers[i] = new customer;
+            customers[i]->Result = (i < n) ? i : labels[i - n];
+        }
+        pointerHeap* baseline = arity[k] ? nullptr : new pointerHeap(n);
+        minHeap* heap = arity[k] ? new minHeap(n, arity[k]) : nullptr;
+        benchClock::time_point start = benchClock::now();
+        for (auto& cus : customers) {
+            arity[k] ? heap->insert(cus) : baseline->insert(cus);
+        }
+        ms[k] = elapsedMs(start);
+        destroy(baseline);
+        destroy(heap);
+    }
+    cout << "  " << n << " areas      " << ms[0] << "\t" << ms[1] << "\t" << ms[2] << "\t" << ms[3] << "\n";
+}
+
+// The plain runtime % that fastModulus replaced, as a baseline
+struct plainModulus {
+    int n;
+    plainModulus(int n) : n(n) {}
+    template <class T>
+    T operator()(T x) const { return x % (T)n; }
+};
+
+template <class Mod>
+static double timePermute(const vector<int>& postorder, int maxsize, int reps, unsigned long long& sink) {
+    benchClock::time_point start = benchClock::now();
+    vector<int> list;
+    vector<int> scratch;
+    for (int r = 0; r < reps; r++) {
+        list = postorder;
+        sink += permuteKernel<Mod>::permute(list, scratch, maxsize);
+    }
+    return elapsedMs(start) / reps;
+}
+
+// Division cost in bucket selection and in KOKUSEN's permutation count on one
+// large bucket of n customers, with MAXSIZE 1000 (a precompiled size)
+static void benchModulo(int n) {
+    const int maxsize = 1000;
+    mt19937 rng(1);
+    vector<int> results(1 << 20);
+    for (auto& r : results) r = rng() % 1024;
+    volatile int runtimeSize = maxsize;
+    plainModulus plain(runtimeSize);
+    fastModulus fast(runtimeSize);
+    unsigned long long sink = 0;
+    double ms[2];
+    benchClock::time_point start = benchClock::now();
+    for (int rep = 0; rep < 20; rep++) {
+        for (int r : results) sink += plain(r + rep);
+    }
+    ms[0] = elapsedMs(start);
+    start = benchClock::now();
+    for (int rep = 0; rep < 20; rep++) {
+        for (int r : results) sink += fast(r + rep);
+    }
+    ms[1] = elapsedMs(start);
+    cout << "modulo, MAXSIZE " << maxsize << " (ms, runtime % vs Barrett vs constant divisor)\n";
+    cout << "  bucket of 20M       " << ms[0] << "\t" << ms[1] << "\n";
+
+    // Results repeat within 0..1023, so a big bucket has long right-leaning runs
+    hashBST table(1);
+    for (int i = 0; i < n; i++) {
+        customer* cus = new customer;
+        cus->Result = rng() % 1024;
+        table.insert(cus);
+    }
+    vector<int> postorder;
+    table.postorder(1, postorder);
+    int reps = max(1, 2000000 / n);
+    double plainMs = timePermute<plainModulus>(postorder, maxsize, reps, sink);
+    double fastMs = timePermute<fastModulus>(postorder, maxsize, reps, sink);
+    double fixedMs = timePermute<fixedModulus<maxsize> >(postorder, maxsize, reps, sink);
+    cout << "  KOKUSEN, " << n << " in bucket " << plainMs << "\t" << fastMs << "\t" << fixedMs << "\n";
+    cout << "  (checksum " << sink % 10000000 << ")\n";
+}
+
+// Discards output but still pays for formatting it
+class nullBuffer : public streambuf {
+   protected:
+    int overflow(int c) { return c; }
+    streamsize xsputn(const char*, streamsize n) { return n; }
+};
+
+// Commands per second through restaurantInbox with several producer threads
+static void benchInbox(int total, int producers) {
+    restaurant* res = new restaurant;
+    restaurantInbox inbox(res);
+    nullBuffer sink;
+    streambuf* old = cout.rdbuf(&sink);
+    inbox.submit("MAXSIZE", "64");
+    inbox.drain(cout);
+
+    atomic<int> consumed(0);
+    int perProducer = total / producers;
+    benchClock::time_point start = benchClock::now();
+    vector<thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.push_back(thread([&inbox, p, perProducer] {
+            mt19937 rng(p + 1);
+            for (int i = 0; i < perProducer; i++) {
+                int op = rng() % 10;
+                if (op < 7) {
+                    inbox.submit("LAPSE", randomName(rng, 3 + rng() % 20));
+                } else if (op == 7) {
+                    inbox.submit("HAND");
+                } else if (op == 8) {
+                    inbox.submit("CLEAVE", "2");
+                } else {
+                    inbox.submit("KEITEIKEN", "1");
+                }
+            }
+        }));
+    }
+    while (consumed.load() < perProducer * producers) {
+        unsigned int n = inbox.drain(cout);
+        if (n == 0) this_thread::yield();
+        consumed += n;
+    }
+    double ms = elapsedMs(start);
+    for (auto& th : threads) th.join();
+    cout.rdbuf(old);
+    cout << "  " << producers << " producer(s)\t" << (long long)(perProducer * producers / (ms / 1000)) << " commands/s\n";
+    destroy(res);
+}
+
+// Discards output and remembers when it was last written to
+class timedBuffer : public nullBuffer {
+   public:
+    benchClock::time_point last;
+
+   protected:
+    int overflow(int c) {
+        last = benchClock::now();
+        return c;
+    }
+    streamsize xsputn(const char*, streamsize n) {
+        last = benchClock::now();
+        return n;
+    }
+};
+
+// One hot tenant per worker queues hot LAPSEs before seven light tenants queue
+// 200 each, so every worker is busy when the light work arrives. Reports when
+// the last hot and the last light tenant finished; with a small quantum the
+// light ones finish long before the hot ones.
+static void benchHost(int hot, unsigned int quantum, int threads) {
+    const int light = 7;
+    int tenants = threads + light;
+    vector<timedBuffer> sinks(tenants);
+    vector<ostream*> outs;
+    for (auto& sink : sinks) outs.push_back(new ostream(&sink));
+    mt19937 rng(1);
+    vector<string> names;
+    for (int i = 0; i < hot + light * 200; i++) names.push_back(randomName(rng, 3 + rng() % 20));
+    benchClock::time_point start;
+    {
+        restaurantHost host(threads, quantum);
+        for (auto& out : outs) host.addTenant(*out);
+        start = benchClock::now();
+        for (int t = 0; t < tenants; t++) host.submit(t, "MAXSIZE", "64");
+        for (int i = 0; i < hot; i++) {
+            for (int t = 0; t < threads; t++) host.submit(t, "LAPSE", names[i]);
+        }
+        for (int t = threads; t < tenants; t++) {
+            for (int i = 0; i < 200; i++) host.submit(t, "LAPSE", names[hot + (t - threads) * 200 + i]);
+        }
+        host.wait();
+    }
+    double hotMs = 0, lightMs = 0;
+    for (int t = 0; t < tenants; t++) {
+        double ms = chrono::duration<double, milli>(sinks[t].last - start).count();
+        double& worst = (t < threads) ? hotMs : lightMs;
+        worst = max(worst, ms);
+    }
+    cout << "  quantum " << quantum << "\thot tenants " << hotMs << " ms, light tenants " << lightMs << " ms\n";
+    for (auto& out : outs) {
+        destroy(out);
+    }
+}
+
+// Synthetic command streams for the per-command suite
+enum benchOp { OP_LAPSE, OP_KOKUSEN, OP_KEITEIKEN, OP_HAND, OP_LIMITLESS, OP_CLEAVE, OP_COUNT };
+static const char* opNames[OP_COUNT] = {"LAPSE", "KOKUSEN", "KEITEIKEN", "HAND", "LIMITLESS", "CLEAVE"};
+
+struct workload {
+    string name;
+    int maxsize;
+    int minLength, maxLength;  // LAPSE name length, log-uniform in this range
+    int alphabet;              // Letters names are drawn from; small alphabets make more rejections
+    int maxNum;                // Upper bound for KEITEIKEN and CLEAVE arguments
+    int mix[OP_COUNT];         // Relative weight of each command
+    int pool;                  // If set, names are shuffles of this many base names
+};
+
+struct benchCommand {
+    int op;
+    int num;
+    string name;
+};
+
+static vector<benchCommand> generate(const workload& w, int count, unsigned int seed) {
+    mt19937 rng(seed);
+    discrete_distribution<int> pick(w.mix, w.mix + OP_COUNT);
+    uniform_real_distribution<double> logLength(log((double)w.minLength), log((double)w.maxLength + 1));
+    vector<string> bases(w.pool);
+    for (auto& base : bases) base = randomName(rng, (int)exp(logLength(rng)), w.alphabet);
+    vector<benchCommand> list(count);
+    for (auto& cmd : list) {
+        cmd.op = pick(rng);
+        cmd.num = 0;
+        if (cmd.op == OP_LAPSE && w.pool) {
+            cmd.name = bases[rng() % w.pool];
+            shuffle(cmd.name.begin(), cmd.name.end(), rng);
+        } else if (cmd.op == OP_LAPSE) {
+            cmd.name = randomName(rng, (int)exp(logLength(rng)), w.alphabet);
+        } else if (cmd.op == OP_LIMITLESS) {
+            cmd.num = 1 + rng() % w.maxsize;
+        } else if (cmd.op == OP_KEITEIKEN || cmd.op == OP_CLEAVE) {
+            cmd.num = 1 + rng() % w.maxNum;
+        }
+    }
+    return list;
+}
+
+static double percentile(vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    return sorted[min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+// Runs one workload through the library API and reports latency percentiles per command
+static void benchWorkload(const workload& w, int count) {
+    vector<benchCommand> list = generate(w, count, 7);
+    vector<double> latency[OP_COUNT];
+    size_t sink = 0;
+    restaurant* res = new restaurant;
+    res->setMAXSIZE(w.maxsize);
+    vector<served> evicted;
+    vector<int> results;
+    benchClock::time_point begin = benchClock::now();
+    for (auto& cmd : list) {
+        benchClock::time_point start = benchClock::now();
+        switch (cmd.op) {
+            case OP_LAPSE:
+                sink += res->LAPSE(cmd.name).Result;
+                break;
+            case OP_KOKUSEN:
+                res->KOKUSEN(evicted);
+                sink += evicted.size();
+                break;
+            case OP_KEITEIKEN:
+                res->KEITEIKEN(cmd.num, evicted);
+                sink += evicted.size();
+                break;
+            case OP_HAND:
+                sink += res->HAND().size();
+                break;
+            case OP_LIMITLESS:
+                res->LIMITLESS(cmd.num, results);
+                sink += results.size();
+                break;
+            default:
+                res->CLEAVE(cmd.num, evicted);
+                sink += evicted.size();
+                break;
+        }
+        latency[cmd.op].push_back(chrono::duration<double, micro>(benchClock::now() - start).count());
+    }
+    double totalMs = elapsedMs(begin);
+    destroy(res);
+
+    cout << w.name << ": " << count << " commands, MAXSIZE " << w.maxsize << ", " << (long long)(count / (totalMs / 1000)) << " commands/s (checksum " << sink << ")\n";
+    cout << "  command      count      p50 us     p90 us     p99 us     max us\n";
+    for (int op = 0; op < OP_COUNT; op++) {
+        vector<double>& v = latency[op];
+        if (v.empty()) continue;
+        sort(v.begin(), v.end());
+        cout << "  " << left << setw(10) << opNames[op] << right << setw(8) << v.size() << fixed << setprecision(2);
+        cout << setw(11) << percentile(v, 0.5) << setw(11) << percentile(v, 0.9) << setw(11) << percentile(v, 0.99) << setw(11) << v.back() << "\n";
+        cout.unsetf(ios::floatfield);
+    }
+}
+
+static void benchSuite(int count) {
+    // name, MAXSIZE, name length range, alphabet, max KEITEIKEN/CLEAVE argument,
+    // weights of LAPSE, KOKUSEN, KEITEIKEN, HAND, LIMITLESS, CLEAVE, anagram pool
+    const workload suite[] = {
+        {"lapse-heavy", 64, 3, 40, 52, 8, {85, 1, 4, 4, 3, 3}},
+        {"long-names", 64, 200, 2000, 52, 8, {90, 1, 3, 2, 2, 2}},
+        {"small-alphabet", 16, 1, 12, 4, 8, {85, 2, 4, 3, 3, 3}},
+        {"kokusen-heavy", 4, 5, 30, 52, 4, {75, 20, 1, 1, 2, 1}},
+        {"keiteiken-heavy", 1024, 5, 30, 52, 64, {70, 1, 25, 1, 1, 2}},
+        {"cleave-heavy", 256, 5, 30, 52, 200, {70, 1, 2, 2, 0, 25}},
+        {"large-maxsize", 100000, 5, 30, 52, 100, {80, 2, 6, 4, 4, 4}},
+        {"anagrams", 64, 10, 400, 52, 8, {85, 1, 4, 4, 3, 3}, 200},
+    };
+    for (auto& w : suite) {
+        benchWorkload(w, count);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // bench [suite|traversals|teardown|inbox|modulo|evict|heap|host] [n]
+    string which = (argc > 1) ? argv[1] : "all";
+    int n = (argc > 2) ? stoi(argv[2]) : 0;
+    if (which == "all" || which == "suite") {
+        benchSuite(n ? n : 20000);
+    }
+    if (which == "all" || which == "traversals") {
+        benchTraversals(n ? n : 1000000);
+    }
+    if (which == "all" || which == "teardown") {
+        benchTeardown(n ? n : 100000);
+    }
+    if (which == "all" || which == "modulo") {
+        benchModulo(n ? n : 2000);
+    }
+    if (which == "all" || which == "evict") {
+        n = n ? n : 20000;
+        cout << "evict, " << n << " customers in one bucket (ms: insert by value, with handles; evict by value, by handle)\n";
+        for (int distinct : {4, 64, 1024}) {
+            benchEvict(n, distinct);
+        }
+    }
+    if (which == "all" || which == "heap") {
+        cout << "heap, build then 2n sift-down inserts (ms: pointer binary, inline keys at arity 2, 4, 8)\n";
+        for (int size : {100000, 1000000}) {
+            if (n == 0 || n == size) benchHeap(size);
+        }
+        if (n != 0 && n != 100000 && n != 1000000) benchHeap(n);
+    }
+    if (which == "all" || which == "inbox") {
+        n = n ? n : 100000;
+        cout << "inbox throughput, " << n << " commands\n";
+        for (int producers : {1, 4, 16}) {
+            benchInbox(n, producers);
+        }
+    }
+    if (which == "all" || which == "host") {
+        n = n ? n : 20000;
+        int threads = max(2u, thread::hardware_concurrency() / 2);
+        cout << "host, " << threads << " workers, a tenant per worker with " << n << " LAPSE queued ahead of 7 with 200\n";
+        for (unsigned int quantum : {64u, 1u << 30}) {
+            benchHost(n, quantum, threads);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include "main.h"
+#include "restaurant.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+namespace reference {
+#include "reference/restaurant.cpp"
+}
+#undef delete
+
+// Differential fuzzing of the restaurant engines. The oracle is a frozen copy of
+// the original single-file restaurant (reference/restaurant.cpp), compiled into
+// its own namespace so it shares no code with the engines under test; every
+// engine, the sequential simulate loop included, must print exactly the same
+// thing for the same command stream.
+//
+// Regression test: fuzz [iterations] [seed]   (make test runs it)
+// libFuzzer target: make fuzz-libfuzzer, then ./build/libfuzzer/fuzz
+
+// Turns fuzzer bytes, or a seeded PRNG, into choices for the command generator
+class commandSource {
+   private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    mt19937* rng;
+
+   public:
+    commandSource(const uint8_t* data, size_t size) : data(data), size(size), pos(0), rng(nullptr) {}
+    commandSource(mt19937* rng) : data(nullptr), size(0), pos(0), rng(rng) {}
+
+    bool more() const { return rng != nullptr || pos < size; }
+
+    unsigned int next(unsigned int bound) {
+        if (rng != nullptr) return (*rng)() % bound;
+        unsigned int value = 0;
+        for (unsigned int range = 1; range < bound && pos < size; range <<= 8) {
+            value = (value << 8) | data[pos++];
+        }
+        return value % bound;
+    }
+};
+
+// Always produces a well-formed stream: one MAXSIZE first, then commands whose
+// arguments stay in the ranges the spec allows, except that KEITEIKEN and
+// CLEAVE also get zero and negative counts, which the original accepts too
+static string generate(commandSource& src, int maxCommands) {
+    static const char alpha[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    ostringstream out;
+    int maxsize = 1 + src.next(64);
+    out << "MAXSIZE " << maxsize << "\n";
+    for (int i = 0; i < maxCommands && src.more(); i++) {
+        unsigned int op = src.next(20);
+        if (op < 12) {
+            int length = 1 + src.next(src.next(4) ? 24 : 400);
+            int alphabet = 1 + src.next(52);
+            string name(length, 'a');
+            for (auto& c : name) c = alpha[src.next(alphabet)];
+            out << "LAPSE " << name << "\n";
+        } else if (op < 14) {
+            out << "KOKUSEN\n";
+        } else if (op < 16) {
+            out << "KEITEIKEN " << (int)src.next(maxsize + 7) - 3 << "\n";
+        } else if (op < 17) {
+            out << "HAND\n";
+        } else if (op < 19) {
+            out << "LIMITLESS " << 1 + src.next(maxsize) << "\n";
+        } else {
+            out << "CLEAVE " << (int)src.next(34) - 3 << "\n";
+        }
+    }
+    return out.str();
+}
+
+// The reference reads a file and prints to cout, so it gets the input through a
+// temporary file and cout is pointed at out while it runs
+static void runReference(const string& input, ostream& out) {
+    char path[] = "/tmp/restaurant-reference-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        out << "mkstemp failed\n";
+        return;
+    }
+    close(fd);
+    ofstream(path) << input;
+    streambuf* old = cout.rdbuf(out.rdbuf());
+    reference::simulate(path);
+    cout.rdbuf(old);
+    unlink(path);
+}
+
+static void runSequential(const string& input, ostream& out) {
+    istringstream in(input);
+    simulate(in, out, 1);
+}
+
+static void runSharded(const string& input, ostream& out, int shards) {
+    istringstream in(input);
+    simulate(in, out, shards);
+}
+
+static void runSharded2(const string& input, ostream& out) { runSharded(input, out, 2); }
+static void runSharded5(const string& input, ostream& out) { runSharded(input, out, 5); }
+
+// One producer, draining in small uneven batches
+static void runInbox(const string& input, ostream& out) {
+    restaurant* res = new restaurant;
+    restaurantInbox* inbox = new restaurantInbox(res);
+    istringstream in(input);
+    string str, arg;
+    unsigned int n = 0;
+    while (in >> str) {
+        arg = "";
+        if (str != "KOKUSEN" && str != "HAND") in >> arg;
+        inbox->submit(str, arg);
+        if (++n % 7 == 0) inbox->drain(out, n % 5 + 1);
+    }
+    while (inbox->drain(out)) {
+    }
+    destroy(inbox);
+    destroy(res);
+}
+
+// Runs half the stream, snapshots to a file, restores into a fresh restaurant
+// through loadSnapshot and runs the rest there
+static void runSnapshot(const string& input, ostream& out) {
+    size_t half = 0;
+    for (size_t lines = count(input.begin(), input.end(), '\n') / 2; lines > 0; lines--) {
+        half = input.find('\n', half) + 1;
+    }
+    restaurant* first = new restaurant;
+    istringstream head(input.substr(0, half));
+    simulate(first, head, out);
+    char path[] = "/tmp/restaurant-snapshot-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) close(fd);
+    restaurant* second = new restaurant;
+    if (fd < 0 || !first->saveSnapshot(path) || !second->loadSnapshot(path)) out << "snapshot failed\n";
+    unlink(path);
+    destroy(first);
+    istringstream tail(input.substr(half));
+    simulate(second, tail, out);
+    destroy(second);
+}
+
+// Logs the first half with small groups and frequent checkpoints, stops as if
+// the process died right after a group commit, recovers into a fresh restaurant
+// and logs the rest on top
+static void runLog(const string& input, ostream& out) {
+    size_t half = 0;
+    for (size_t lines = count(input.begin(), input.end(), '\n') / 2; lines > 0; lines--) {
+        half = input.find('\n', half) + 1;
+    }
+    char dir[] = "/tmp/restaurant-log-XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        out << "mkdtemp failed\n";
+        return;
+    }
+    restaurant* first = new restaurant;
+    commandLog* log = new commandLog(dir, 3, 7);
+    log->recover(first);
+    istringstream head(input.substr(0, half));
+    simulate(first, head, out, log);
+    log->commit();
+    destroy(log);
+    destroy(first);
+
+    restaurant* second = new restaurant;
+    log = new commandLog(dir, 3, 7);
+    if (!log->recover(second)) out << "recovery failed\n";
+    istringstream tail(input.substr(half));
+    simulate(second, tail, out, log);
+    destroy(log);
+    destroy(second);
+
+    DIR* d = opendir(dir);
+    while (dirent* entry = d ? readdir(d) : nullptr) {
+        if (entry->d_name[0] != '.') unlink((string(dir) + "/" + entry->d_name).c_str());
+    }
+    if (d) closedir(d);
+    rmdir(dir);
+}
+
+// Three tenants fed the same stream in interleaved bursts of different sizes,
+// on two workers with a small quantum so their turns interleave too. Every
+// tenant must print what the reference prints.
+static void runHost(const string& input, ostream& out) {
+    const int tenants = 3;
+    ostringstream outputs[tenants];
+    {
+        restaurantHost host(2, 5);
+        size_t pos[tenants] = {};
+        for (int t = 0; t < tenants; t++) host.addTenant(outputs[t]);
+        for (bool more = true; more;) {
+            more = false;
+            for (int t = 0; t < tenants; t++) {
+                for (int burst = 0; burst < 3 * t + 1; burst++) {
+                    string_view str = nextToken(input, pos[t]);
+                    if (str.empty()) break;
+                    string_view arg;
+                    if (str != "KOKUSEN" && str != "HAND") arg = nextToken(input, pos[t]);
+                    host.submit(t, str, arg);
+                    more = true;
+                }
+            }
+        }
+    }
+    out << outputs[0].str();
+    for (int t = 1; t < tenants; t++) {
+        if (outputs[t].str() != outputs[0].str()) out << "tenant " << t << " differs from tenant 0\n";
+    }
+}
+
+struct engine {
+    const char* name;
+    void (*run)(const string& input, ostream& out);
+};
+
+// Alternative engines checked against the reference; add new ones here
+static const engine engines[] = {
+    {"sequential", runSequential},
+    {"sharded-2", runSharded2},
+    {"sharded-5", runSharded5},
+    {"inbox", runInbox},
+    {"snapshot", runSnapshot},
+    {"log", runLog},
+    {"host", runHost},
+};
+
+// Returns false and reports the first differing line if any engine disagrees
+static bool compareEngines(const string& input, ostream& report) {
+    ostringstream expected;
+    runReference(input, expected);
+    for (auto& e : engines) {
+        ostringstream actual;
+        e.run(input, actual);
+        if (actual.str() == expected.str()) continue;
+        istringstream want(expected.str()), got(actual.str());
+        string a, b;
+        int line = 1;
+        while (true) {
+            bool moreA = (bool)getline(want, a);
+            bool moreB = (bool)getline(got, b);
+            if (!moreA && !moreB) break;
+            if (moreA != moreB || a != b) {
+                report << e.name << " differs at output line " << line << "\n";
+                report << "  reference: " << (moreA ? a : "<end of output>") << "\n";
+                report << "  " << e.name << ": " << (moreB ? b : "<end of output>") << "\n";
+                break;
+            }
+            line++;
+        }
+        return false;
+    }
+    return true;
+}
+
+#ifdef LIBFUZZER
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    commandSource src(data, size);
+    string input = generate(src, 200);
+    if (!compareEngines(input, cerr)) {
+        cerr << "input:\n" << input;
+        abort();
+    }
+    return 0;
+}
+#else
+int main(int argc, char* argv[]) {
+    int iterations = (argc > 1) ? stoi(argv[1]) : 200;
+    unsigned int seed = (argc > 2) ? stoul(argv[2]) : 1;
+    for (int i = 0; i < iterations; i++) {
+        mt19937 rng(seed + i);
+        commandSource src(&rng);
+        string input = generate(src, 50 + rng() % 400);
+        if (!compareEngines(input, cout)) {
+            cout << "seed " << seed + i << " failed, input written to fuzz-failure.txt\n";
+            ofstream("fuzz-failure.txt") << input;
+            return 1;
+        }
+    }
+    cout << iterations << " command streams matched across " << sizeof(engines) / sizeof(engines[0]) << " engines\n";
+    return 0;
+}
+#endif
@@ -1,12 +1,73 @@
 #include "main.h"
-#include "restaurant.cpp"
+#include "restaurant.h"
 
 int main(int argc, char* argv[]) {
     if (argc < 2)
         return 1;
+    // ./main --batch <outdir> [-j threads] <file|dir>...: every file on its own
+    // restaurant, outputs in outdir, per-file and total times on stdout
+    if (string(argv[1]) == "--batch") {
+        if (argc < 4) return 1;
+        string outDir = argv[2];
+        int threads = thread::hardware_concurrency();
+        int first = 3;
+        if (string(argv[3]) == "-j" && argc > 4) {
+            threads = stoi(argv[4]);
+            first = 5;
+        }
+        vector<string> inputs = batchInputs(vector<string>(argv + first, argv + argc));
+        threads = max(1, min(threads, (int)inputs.size()));
+        auto start = chrono::steady_clock::now();
+        vector<batchResult> results = runBatch(inputs, outDir, threads);
+        double wall = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        double total = 0;
+        int failed = 0;
+        for (auto& r : results) {
+            cout << fixed << setprecision(3) << setw(10) << r.seconds * 1000 << " ms  " << r.input;
+            cout << (r.ok ? " -> " + r.output : " FAILED") << "\n";
+            total += r.seconds * 1000;
+            if (!r.ok) failed++;
+        }
+        cout << results.size() << " files, " << failed << " failed, " << wall << " ms wall, " << total << " ms summed, " << threads << " workers\n";
+        return failed ? 1 : 0;
+    }
+
     string fileName = argv[1];
 
+    // ./main <file> --log <dir>: recover from dir, then apply and log the file.
+    // The log records the sequential engine, so this mode takes no shard count.
+    // A MAXSIZE in the file starts over with empty areas, so a file meant to
+    // continue the recovered state leaves it out.
+    if (argc > 2 && string(argv[2]) == "--log") {
+        if (argc != 4) {
+            cerr << "usage: main <file> --log <dir>" << endl;
+            return 1;
+        }
+        restaurant* res = new restaurant;
+        commandLog* log = new commandLog(argv[3]);
+        if (!log->recover(res)) {
+            cerr << "cannot recover from " << argv[3] << endl;
+            return 1;
+        }
+        ifstream ss(fileName);
+        bool ok = simulate(res, ss, cout, log) && log->commit();
+        destroy(log);
+        destroy(res);
+        if (!ok) {
+            cerr << "cannot write the log in " << argv[3] << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // ./main <file> [shards]
+    if (argc > 3) {
+        cerr << "usage: main <file> [shards] | main <file> --log <dir>" << endl;
+        return 1;
+    }
+    int shards = (argc > 2) ? stoi(argv[2]) : 1;
+
     // string fileName = "test.txt";
-    simulate(fileName);
+    simulate(fileName, shards);
     return 0;
 }
@@ -1,2 +1,2 @@
-g++ -o main main.cpp -I . -std=c++11 -fsanitize=address -static-libasan -g
+g++ -o main main.cpp restaurant.cpp -I . -std=c++17 -pthread -fsanitize=address -static-libasan -g
 ./main test.txt
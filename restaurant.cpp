@@ -1,865 +1,939 @@
 #include "main.h"
-#define delete(x) \
-    delete x;     \
-    x = nullptr;
+#include "restaurant.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+restaurant::admission restaurant::LAPSE(string_view name) {
+    STATS(statsTimer timer(restaurantStats::LAPSE));
+    customer* cus = prepareLAPSE(name, pendingHand, trace);
+    return admitLAPSE(cus, pendingHand);
+}
 
-// Huffman tree node abstract base class
-class HuffNode {
-   public:
-    virtual ~HuffNode(){};      // Base destructor
-    virtual int weight() = 0;   // Return frequency
-    virtual bool isLeaf() = 0;  // Determine type
-    virtual HuffNode* left() const { return NULL; }
-    virtual void setLeft(HuffNode* b){};
-    virtual HuffNode* right() const { return NULL; };
-    virtual void setRight(HuffNode* b){};
-    virtual void update() { return; }
-    virtual HuffNode* parent() const { return NULL; }
-    virtual void setParent(HuffNode* b){};
-    virtual char val() { return 0; }
-};
+// Huffman encoding and Result of a new customer. Touches no restaurant state, so
+// it can run on any thread; returns nullptr if the customer is turned away.
+// Everything up to the cache lookup lives on the stack, so a cache hit allocates
+// nothing but the customer itself.
+customer* restaurant::prepareLAPSE(string_view name, handCode& inorder, ostream* trace) const {
+    int length = name.length();
+    int freq[256] = {};
 
-// Leaf node subclass
-class LeafNode : public HuffNode {
-   private:
-    char it;  // Value
-    int wgt;  // Weight
-   public:
-    LeafNode(const char& val, int freq)  // Constructor
-    {
-        it = val;
-        wgt = freq;
+    for (char c : name) {
+        freq[(unsigned char)c]++;
+    }
+    // Caesar shift per character. The name is never encoded as a whole; the
+    // Result loop below maps only the tail it consumes through this table.
+    // Characters that shift onto the same letter are merged by adding up their
+    // frequencies.
+    char caesar[256] = {};
+    int merged[256] = {};
+    int distinct = 0;
+    for (int c = 0; c < 256; c++) {
+        if (freq[c] == 0) continue;
+        distinct++;
+        caesar[c] = encodeCaesar((char)c, freq[c]);
+        merged[(unsigned char)caesar[c]] += freq[c];
+    }
+    if (distinct < 3) {
+        STATS(restaurantStats::instance().rejectedFewLetters++);
+        return nullptr;
+    }
+    letter listChr[256];
+    int count = 0;
+    for (int c = 0; c < 256; c++) {
+        if (merged[c] == 0) continue;
+        listChr[count].encodeCaesar = (char)c;
+        listChr[count].freq = merged[c];
+        count++;
+    }
+    std::sort(listChr, listChr + count, [](const letter& a, const letter& b) {
+        if (a.freq != b.freq) {
+            return a.freq < b.freq;
+        } else if ((a.encodeCaesar < 'a' && b.encodeCaesar < 'a') || (a.encodeCaesar >= 'a' && b.encodeCaesar >= 'a')) {
+            return a.encodeCaesar < b.encodeCaesar;
+        }
+        return a.encodeCaesar > b.encodeCaesar;
+    });
+    unsigned long long signature[256];
+    for (int i = 0; i < count; i++) {
+        signature[i] = ((unsigned long long)(unsigned char)listChr[i].encodeCaesar << 32) | (unsigned int)listChr[i].freq;
+    }
+    huffmanCache& cache = huffmanCache::local();
+    huffmanCache::entry* e = cache.find(signature, count, trace != nullptr);
+    if (e != nullptr) {
+        STATS(restaurantStats::instance().huffmanHits++);
+        if (trace) *trace << e->trace;
+    } else {
+        STATS(restaurantStats::instance().huffmanMisses++);
+        e = &cache.fill(signature, count);
+        buildHuffman(listChr, count, *e, trace);
+    }
+    if (e->unreal) {
+        STATS(restaurantStats::instance().rejectedUnreal++);
+        return nullptr;
+    }
+    inorder = e->inorder;
+
+    // The Result is the last 10 bits of the codes of the name's tail, read
+    // backwards. Collect them from the last character until there are 10.
+    unsigned int bits = 0;
+    int collected = 0;
+    for (int i = length - 1; i >= 0 && collected < 10; i--) {
+        const huffCode& code = e->codes[(unsigned char)caesar[(unsigned char)name[i]]];
+        bits |= (unsigned int)code.bits << collected;
+        collected += code.len;
+    }
+    int width = min(collected, 10);
+    customer* cus = new customer;
+    for (int k = 0; k < width; k++) {
+        cus->Result = (cus->Result << 1) | ((bits >> k) & 1);
     }
-    int weight() { return wgt; }
-    char val() { return it; }
-    bool isLeaf() { return true; }
-};
+    if (trace) *trace << cus->Result << endl;
+    return cus;
+}
 
-// Internal node subclass
-class IntlNode : public HuffNode {
-   private:
-    HuffNode* pa;
-    HuffNode* lc;  // Left child
-    HuffNode* rc;  // Right child
-    int wgt;       // Subtree weight
-   public:
-    IntlNode(HuffNode* l, HuffNode* r, HuffNode* p) {
-        wgt = l->weight() + r->weight();
-        lc = l;
-        rc = r;
-        pa = p;
-    }
-    ~IntlNode() {
-        // delete lc;
-        // delete rc;
-    }
-    int weight() { return wgt; }
-    bool isLeaf() { return false; }
-    HuffNode* left() const { return lc; }
-    void setLeft(HuffNode* b) {
-        lc = b;
-        lc->setParent(this);
-    }
-    HuffNode* right() const { return rc; }
-    void setRight(HuffNode* b) {
-        rc = b;
-        rc->setParent(this);
-    }
-    void update() { wgt = lc->weight() + rc->weight(); }
-    HuffNode* parent() const { return pa; }
-    void setParent(HuffNode* b) { pa = b; }
-};
+// Builds, rotates and reads the Huffman tree for the count letters of listChr
+// into e, then frees it. The trace output is written to trace and, when there is
+// one, kept in e.
+void restaurant::buildHuffman(const letter* listChr, int count, huffmanCache::entry& e, ostream* out) const {
+    ostringstream capture;
+    ostream* trace = out ? &capture : nullptr;
+    priority_queue<HuffTree*, vector<HuffTree*>, compare> pq;
+    int order = 0;
+    for (int i = 0; i < count; i++) {
+        // cout << listChr[i].encodeCaesar << " " << listChr[i].freq << endl;
+        char val = listChr[i].encodeCaesar;
+        pq.push(new HuffTree(val, listChr[i].freq, order++));
+    }
+    // Only the last merge's flag decides, and every merge's rotations are traced,
+    // so an earlier flag cannot end the loop. The counters show how often a
+    // flag is raised and then cleared by a later merge.
+    bool unreal = false;
+    // int i = 0;
+    HuffTree *temp1, *temp2, *tree;
+    while (pq.size() > 1) {
+        temp1 = pq.top();
+        pq.pop();
+        temp2 = pq.top();
+        pq.pop();
+        tree = new HuffTree(temp1, temp2, order++);
 
-class HuffTree {
-   private:
-    HuffNode* Root;
+        // cout << "Iteration " << i++ << ":" << endl;
+        // cout << "sub tree 1--------------------------------------------------" << endl;
+        // temp1->printHuffmanTree(temp1->root());
+        // cout << "sub tree 2--------------------------------------------------" << endl;
+        // temp2->printHuffmanTree(temp2->root());
+        STATS(restaurantStats::instance().merges++);
+        STATS(if (unreal) restaurantStats::instance().unrealOverridden++);
+        unreal = tree->rotateTree(trace);
+        STATS(if (unreal) restaurantStats::instance().unrealFlags++);
+        // cout << "new tree----------------------------------------------------" << endl;
+        // tree->printHuffmanTree(tree->root());
+        // cout << "------------------------------------------------------------" << endl
+        //      << endl;
 
-   public:
-    HuffTree(char& val, int freq) { Root = new LeafNode(val, freq); }
-    HuffTree(HuffTree* l, HuffTree* r) { Root = new IntlNode(l->root(), r->root(), this->root()); }
-    void removeHuffTree(HuffNode* node) {
-        if (node) {
-            removeHuffTree(node->left());
-            removeHuffTree(node->right());
-            delete (node);
-        }
+        pq.push(tree);
+        destroy(temp1);
+        destroy(temp2);
     }
-    ~HuffTree() {}  // Destructor
-
-    HuffNode* root() { return Root; }  // Get root
-    void setRoot(HuffNode* node) { Root = node; }
-    int weight() { return Root->weight(); }  // Root weight
-    int getHight(HuffNode* root) {
-        if (root == nullptr) {
-            return 0;
-        }
-        return max(getHight(root->left()), getHight(root->right())) + 1;
+    tree = pq.top();
+    pq.pop();
+    e.unreal = unreal;
+    if (!unreal) {
+        tree->getInorderTree(tree->root(), e.inorder);
+        tree->getCodes(tree->root(), e.codes);
+        // print Huffman tree
+        if (trace) {
+            tree->printHuffmanTree(tree->root(), *trace);
+            *trace << "------------------------------------------------------------" << endl;
+        }
+    }
+    tree->removeHuffTree(tree->root());
+    destroy(tree);
+    if (out) {
+        e.trace = capture.str();
+        e.traced = true;
+        *out << e.trace;
     }
+}
 
-    int getBalance(HuffNode* root) {
-        return (root == nullptr) ? 0 : (getHight(root->left()) - getHight(root->right()));
-    }
+restaurant::admission restaurant::admitLAPSE(customer* cus, handCode& inorder) {
+    if (cus == nullptr) return {false, 0, 0};
+    lastCustomer.swap(inorder);
+    handStale = true;
+    (cus->Result % 2) ? gojo->insert(cus) : sukuna->insert(cus);
+    return {true, cus->Result, labelOf(cus->Result) + 1};
+}
 
-    HuffNode* rotateLeft(HuffNode* root) {
-        cout << "Rotate left" << endl;
-        HuffNode* temp = root->right();
-        root->setRight(temp->left());
-        temp->setLeft(root);
-        // root->update();  // No need
-        // temp->update();
-        return temp;
+void restaurant::KOKUSEN(vector<served>& evicted) {
+    STATS(statsTimer timer(restaurantStats::KOKUSEN));
+    evicted.clear();
+    for (int i = 1; i <= maxsize; i++) {
+        KOKUSEN(i, evicted, kokusen, trace);
     }
+}
 
-    HuffNode* rotateRight(HuffNode* root) {
-        cout << "Rotate right\n";
-        HuffNode* temp = root->left();
-        root->setLeft(temp->right());
-        temp->setRight(root);
-        // root->update();  // No need
-        // temp->update();
-        return temp;
-    }
+// KOKUSEN on a single bucket; buckets are independent of each other as long as
+// each thread brings its own scratch
+void restaurant::KOKUSEN(int id, vector<served>& evicted, kokusenScratch& scratch, ostream* trace) {
+    vector<int>& list = scratch.order;
+    gojo->postorder(id, list);
+    // for (auto& num : list) {
+    //     cout << num << " ";
+    // }
+    if (!list.size()) return;
+    unsigned long long numPermute = permutePostOrder(list, scratch.partition);
+    if (trace && numPermute > 0) *trace << "Hoan vi: " << numPermute << "\n";
+    gojo->remove(id, numPermute, evicted);
+}
 
-    void printHuffmanTree(HuffNode* root, int indent = 0) {
-        if (root == nullptr) {
-            return;
-        }
+void restaurant::KEITEIKEN(int num, vector<served>& evicted) {
+    STATS(statsTimer timer(restaurantStats::KEITEIKEN));
+    evicted.clear();
+    sukuna->remove(num, evicted);
+}
 
-        if (root->isLeaf()) {
-            LeafNode* leaf = static_cast<LeafNode*>(root);
-            cout << string(indent, ' ') << "Leaf: " << leaf->val() << " (" << leaf->weight() << ")" << endl;
-        } else {
-            IntlNode* intl = static_cast<IntlNode*>(root);
-            cout << string(indent, ' ') << "Internal Node: " << intl->weight() << " (Height: " << getHight(intl) << ")" << endl;
-            cout << string(indent, ' ') << "├─ Left:" << endl;
-            printHuffmanTree(intl->left(), indent + 4);
-            cout << string(indent, ' ') << "└─ Right:" << endl;
-            printHuffmanTree(intl->right(), indent + 4);
-        }
-    }
-
-    void getInorderTree(HuffNode* root, string& result) {
-        if (root == nullptr) return;
-        getInorderTree(root->left(), result);
-        if (root->isLeaf()) {
-            result += root->val();
-            result += "\n";
-        } else {
-            result += to_string(root->weight());
-            result += "\n";
-        }
-        getInorderTree(root->right(), result);
+const string& restaurant::HAND() const {
+    STATS(statsTimer timer(restaurantStats::HAND));
+    if (handStale) {
+        lastCustomer.render(handText);
+        handStale = false;
     }
+    return handText;
+}
 
-    HuffNode* checkRotate(HuffNode* root, bool& isRotate, bool& unreal) {
-        if (unreal) return root;
-        if (root->isLeaf()) return root;
-        if (getBalance(root) > 1) {
-            if (getBalance(root->left()) >= 0) {
-                root = rotateRight(root);
-            } else {
-                root->setLeft(rotateLeft(root->left()));
-                root = rotateRight(root);
-            }
-            if (root->isLeaf() && (root->right() != nullptr || root->left() != nullptr)) unreal = true;
-            isRotate = true;
-            return root;
-        } else if (getBalance(root) < -1) {
-            if (getBalance(root->right()) <= 0) {
-                root = rotateLeft(root);
-            } else {
-                root->setRight(rotateRight(root->right()));
-                root = rotateLeft(root);
-            }
-            if (root->isLeaf() && (root->right() != nullptr || root->left() != nullptr)) unreal = true;
-            isRotate = true;
-            return root;
-        }
-        if (!isRotate) root->setLeft(checkRotate(root->left(), isRotate, unreal));
-        if (!isRotate) root->setRight(checkRotate(root->right(), isRotate, unreal));
-        return root;
-    }
-
-    bool rotateTree() {
-        bool unreal = false;
-        for (int i = 0; i < 3; i++) {
-            bool isRotate = false;
-            // printHuffmanTree(Root);
-            Root = checkRotate(Root, isRotate, unreal);
-            if (unreal || !isRotate) return unreal;
-        }
-        return unreal;
-    }
+void restaurant::LIMITLESS(int num, vector<int>& list) {
+    STATS(statsTimer timer(restaurantStats::LIMITLESS));
+    gojo->inorder(num, list);
+}
 
-    void getEncodeList(HuffNode* root, string str, unordered_map<char, string>& encodingMap) {
-        if (root == nullptr) return;
+void restaurant::CLEAVE(int num, vector<served>& list) {
+    STATS(statsTimer timer(restaurantStats::CLEAVE));
+    list.clear();
+    sukuna->preorder(num, list);
+}
 
-        if (root->isLeaf()) {
-            encodingMap[root->val()] = str;
-        }
-        getEncodeList(root->left(), str + "0", encodingMap);
-        getEncodeList(root->right(), str + "1", encodingMap);
+void printKEITEIKEN(ostream& out, const vector<served>& evicted) {
+    for (auto& cus : evicted) {
+        out << cus.Result << "-" << cus.label << "\n";
     }
-};
+}
 
-class customer {
-   public:
-    int Result;
-    HuffTree* tree;
-    customer* left;
-    customer* right;
-    customer() : Result(0), tree(nullptr), left(nullptr), right(nullptr){};
-    ~customer() {
-        tree->removeHuffTree(tree->root());
-        delete (tree);
+void printLIMITLESS(ostream& out, const vector<int>& list) {
+    for (auto& result : list) {
+        out << result << "\n";
     }
-};
+}
 
-class hashBST {
-   public:
-    struct BSTNode {
-        int result;
-        BSTNode *left, *right;
-    };
-    class BSTTree;
+void printCLEAVE(ostream& out, const vector<served>& list) {
+    for (auto& cus : list) {
+        out << cus.label << "-" << cus.Result << "\n";
+    }
+}
 
-   private:
-    int size;
-    vector<BSTTree*> table;
+static const int32_t SNAPSHOT_MAGIC = 0x504e5352;  // "RSNP"
+static const int32_t SNAPSHOT_VERSION = 2;
 
-   public:
-    hashBST(int num) : size(num) {
-        table = vector<BSTTree*>(size + 1, nullptr);
+string restaurant::snapshot() {
+    snapshotWriter w;
+    w.put(SNAPSHOT_MAGIC);
+    w.put(SNAPSHOT_VERSION);
+    w.put(maxsize);
+    if (maxsize > 0) {
+        gojo->save(w);
+        sukuna->save(w);
     }
-    ~hashBST() {
-        for (unsigned int i = 0; i < table.size(); i++) {
-            if (table[i] != nullptr) {
-                delete (table[i]);
-            }
-        }
+    w.put(lastCustomer.size());
+    for (unsigned int i = 0; i < lastCustomer.size(); i++) {
+        w.put(lastCustomer[i]);
     }
+    return move(w.data());
+}
 
-    void insert(customer* cus) {
-        int id = cus->Result % size + 1;
-        if (table[id] == nullptr) {
-            table[id] = new BSTTree;
-        }
-        table[id]->insert(cus);
-    }
+bool restaurant::restore(const char* data, size_t size) {
+    clear();
+    snapshotReader r(data, size);
+    if (r.get() != SNAPSHOT_MAGIC || r.get() != SNAPSHOT_VERSION) return clear();
+    int num = r.get();
+    if (!r.good() || num < 0) return clear();
+    if (num > 0) {
+        setMAXSIZE(num);
+        if (!gojo->load(r) || !sukuna->load(r)) return clear();
+    }
+    int nodes = r.get();
+    if (!r.good() || nodes < 0 || (size_t)nodes > r.remaining()) return clear();
+    for (int i = 0; i < nodes; i++) {
+        lastCustomer.push(r.get());
+    }
+    if (!r.good() || !r.done()) return clear();
+    handStale = true;
+    return true;
+}
 
-    void remove(int id, int n) {  // TODO: ???????
-        if (table[id]->root == nullptr) return;
-        table[id]->remove(n);
-        if (table[id]->root == nullptr) {
-            delete (table[id]);
-        }
-    }
+bool restaurant::saveSnapshot(const string& path) {
+    string data = snapshot();
+    ofstream file(path, ios::binary | ios::trunc);
+    file.write(data.data(), data.size());
+    return (bool)file;
+}
 
-    void postorderTraversal(BSTNode* root, vector<int>& result) {
-        if (root == NULL) {
-            return;
-        }
-        postorderTraversal(root->left, result);
-        postorderTraversal(root->right, result);
-        result.push_back(root->result);
-    }
+// Maps path read-only and hands its bytes to fn; false if it is missing or empty
+template <class F>
+static bool readMapped(const string& path, F fn) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    bool ok = fn(static_cast<const char*>(data), (size_t)st.st_size);
+    munmap(data, st.st_size);
+    return ok;
+}
 
-    vector<int> postorder(int id) {
-        vector<int> list;
-        // stack<BSTNode*> st;
-        BSTTree* tree = table[id];
-        if (tree == nullptr) return list;
-        postorderTraversal(tree->root, list);
-        // st.push(tree->root);
-        // while (!st.empty()) {
-        //     BSTNode* node = st.top();
-        //     st.pop();
-        //     cout << node->result << " ";
-        //     list.push_back(node->result);
-        //     if (node->left != nullptr) st.push(node->left);
-        //     if (node->right != nullptr) st.push(node->right);
-        // }
-        return list;
-    }
+bool restaurant::loadSnapshot(const string& path) {
+    return readMapped(path, [this](const char* data, size_t size) { return restore(data, size); });
+}
 
-    void printTree(int id) {
-        BSTTree* tree = table[id];
-        if (tree == nullptr) return;
-        printTree(tree->root, "", true);
+static bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= n;
     }
+    return true;
+}
 
-    void printTree(BSTNode* node, const string& prefix, bool isLeft) {
-        if (node == nullptr) return;
+static void syncDir(const string& dir) {
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
 
-        cout << prefix;
-        cout << (isLeft ? "├── " : "└── ");
-        cout << node->result << endl;
+commandLog::~commandLog() {
+    commit();
+    if (fd >= 0) close(fd);
+}
 
-        string childPrefix = prefix + (isLeft ? "│   " : "    ");
-        printTree(node->left, childPrefix, true);
-        printTree(node->right, childPrefix, false);
-    }
+bool commandLog::openLog(int gen, bool truncate) {
+    int next = open(logPath(gen).c_str(), O_WRONLY | O_CREAT | O_APPEND | (truncate ? O_TRUNC : 0), 0644);
+    if (next < 0) return false;
+    if (fd >= 0) close(fd);
+    fd = next;
+    generation = gen;
+    return true;
+}
 
-    void printInorder(BSTNode* root) {
-        if (root == nullptr) return;
-        printInorder(root->left);
-        cout << root->result << "\n";
-        printInorder(root->right);
-    }
+bool commandLog::recover(restaurant* res) {
+    mkdir(dir.c_str(), 0755);
+    // The checkpoint is the generation word followed by a restaurant snapshot
+    int gen = 0;
+    bool ok = readMapped(dir + "/checkpoint", [&](const char* data, size_t size) {
+        if (size < sizeof(int32_t)) return false;
+        memcpy(&gen, data, sizeof(int32_t));
+        return res->restore(data + sizeof(int32_t), size - sizeof(int32_t));
+    });
+    if (!ok && gen != 0) return false;
+
+    // Replay whole records only; a torn final line from a crash is cut off
+    size_t valid = 0;
+    unsigned int replayed = 0;
+    readMapped(logPath(gen), [&](const char* data, size_t size) {
+        const char* last = static_cast<const char*>(memrchr(data, '\n', size));
+        valid = last ? last - data + 1 : 0;
+        replayed = count(data, data + valid, '\n');
+        ostream discard(nullptr);
+        simulate(res, string_view(data, valid), discard);
+        res->setTrace(nullptr);
+        return true;
+    });
+    if (!openLog(gen, false) || ftruncate(fd, valid) != 0) return false;
+    // The replayed records count towards the next checkpoint, so short runs
+    // between restarts cannot grow the tail without bound
+    sinceCheckpoint = replayed;
+    if (sinceCheckpoint >= checkpointEvery) return checkpoint(res);
+    return true;
+}
 
-    void printInorder(int id) {
-        BSTTree* tree = table[id];
-        if (tree == nullptr) return;
-        printInorder(tree->root);
+bool commandLog::append(string_view name, string_view arg) {
+    pending += name;
+    if (!arg.empty()) {
+        pending += ' ';
+        pending += arg;
     }
+    pending += '\n';
+    return ++pendingCount < groupSize || commit();
+}
 
-   public:
-    class BSTTree {
-       public:
-        BSTNode* root;
-        queue<customer*> q;
-
-       public:
-        BSTTree() : root(nullptr) {}
-        ~BSTTree() {
-            removeTree(root);
-            while (!q.empty()) {
-                customer* cus = q.front();
-                q.pop();
-                delete (cus);
-            }
-        }
-        void removeTree(BSTNode*& root) {
-            if (root == nullptr) return;
-            removeTree(root->left);
-            removeTree(root->right);
-            delete (root);
-        }
-        BSTNode* insert(BSTNode* root, int result) {
-            if (root == nullptr) return new BSTNode{result, nullptr, nullptr};
-            if (result < root->result) {
-                root->left = insert(root->left, result);
-            } else {
-                root->right = insert(root->right, result);
-            }
-            return root;
-        }
-        void insert(customer* cus) {
-            root = insert(root, cus->Result);
-            q.push(cus);
-        }
-        void remove(unsigned int n) {
-            if (n >= q.size()) {
-                removeTree(root);
-                while (!q.empty()) {
-                    customer* cus = q.front();
-                    q.pop();
-                    delete (cus);
-                }
-                return;
-            }
-            while (n--) {
-                customer* cus = q.front();
-                q.pop();
-                root = remove(root, cus->Result);
-                delete (cus);
-            }
-        }
-        BSTNode* remove(BSTNode* root, int result) {
-            if (root == nullptr) return root;
-            if (result < root->result) {
-                root->left = remove(root->left, result);
-            } else if (result > root->result) {
-                root->right = remove(root->right, result);
-            } else {
-                if (root->left == nullptr) {
-                    BSTNode* temp = root->right;
-                    delete (root);
-                    return temp;
-                } else if (root->right == nullptr) {
-                    BSTNode* temp = root->left;
-                    delete (root);
-                    return temp;
-                }
-                BSTNode* temp = root->right;
-                while (temp->left != nullptr) {
-                    temp = temp->left;
-                }
-                root->result = temp->result;
-                root->right = remove(root->right, temp->result);
-            }
-            return root;
-        }
-        customer* search(customer* root, int Result) {  // FIXME: ??????????
-            if (root == nullptr || root->Result == Result) return root;
-            if (root->Result < Result) return search(root->right, Result);
-            return search(root->left, Result);
-        }
-    };
-};
+// A failed group is cut back off the log and stays pending, so a later commit
+// writes it again instead of leaving half of it or a duplicate behind
+bool commandLog::commit() {
+    if (pendingCount == 0) return true;
+    if (fd < 0) return false;
+    off_t start = lseek(fd, 0, SEEK_END);
+    if (start < 0) return false;
+    if (!writeAll(fd, pending.data(), pending.size()) || fdatasync(fd) != 0) {
+        if (ftruncate(fd, start) != 0) {
+            // The log now ends in a partial group; refuse further records
+            close(fd);
+            fd = -1;
+        }
+        return false;
+    }
+    pending.clear();
+    pendingCount = 0;
+    return true;
+}
 
-class minHeap {
-   public:
-    class area;
+// The new log generation is created before the checkpoint that names it is
+// renamed into place, so a crash at any point leaves a checkpoint whose log
+// generation is complete. If the checkpoint cannot be written, the log goes
+// back to the old generation, which the current checkpoint still names.
+bool commandLog::checkpoint(restaurant* res) {
+    sinceCheckpoint = 0;
+    if (!commit()) return false;
+    int old = generation;
+    if (!openLog(old + 1, true)) return false;
+    string tmp = dir + "/checkpoint.tmp";
+    int out = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = out >= 0;
+    if (ok) {
+        int32_t gen = generation;
+        string data = res->snapshot();
+        ok = writeAll(out, reinterpret_cast<const char*>(&gen), sizeof(gen)) && writeAll(out, data.data(), data.size()) && fsync(out) == 0;
+        close(out);
+    }
+    if (!ok || rename(tmp.c_str(), (dir + "/checkpoint").c_str()) != 0) {
+        unlink(tmp.c_str());
+        unlink(logPath(old + 1).c_str());
+        if (!openLog(old, false)) {
+            // Nothing may go to a generation recovery will not replay
+            close(fd);
+            fd = -1;
+        }
+        return false;
+    }
+    syncDir(dir);
+    unlink(logPath(old).c_str());
+    return true;
+}
 
+// Runs tasks one at a time, in submission order, on its own thread
+class workerQueue {
    private:
-    int capacity;
-    unsigned int time;
-    int size;
-    vector<area*> table;
-
-   public:
-    minHeap(int num) : capacity(num), time(0), size(0) {
-        table = vector<area*>(capacity + 1, nullptr);
-    };
-
-    ~minHeap() {
-        for (int i = 1; i <= size; i++) {
-            if (table[i] != nullptr) {
-                delete (table[i]);
-            }
-        }
-    }
-
-    void printHeap() {
-        for (int i = 1; i <= size; i++) {
-            cout << table[i]->label << " " << table[i]->num << " " << table[i]->time << endl;
+    mutex mtx;
+    condition_variable cv;
+    condition_variable idle;
+    queue<function<void()>> tasks;
+    bool running;
+    bool stopping;
+    thread worker;
+
+    void run() {
+        unique_lock<mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+            function<void()> task = move(tasks.front());
+            tasks.pop();
+            running = true;
+            lock.unlock();
+            task();
+            lock.lock();
+            running = false;
+            if (tasks.empty()) idle.notify_all();
         }
     }
 
-    void reheapup(int i) {
-        if (i == 1) return;
-        int parent = i / 2;
-        if (table[i]->num < table[parent]->num) {
-            swap(table[i], table[parent]);
-            reheapup(parent);
+   public:
+    workerQueue() : running(false), stopping(false), worker(&workerQueue::run, this) {}
+    ~workerQueue() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
         }
+        cv.notify_one();
+        worker.join();
     }
 
-    void reheapdown(int i) {
-        int left = i * 2;
-        int right = i * 2 + 1;
-        if (left > size) return;
-        int min = left;
-        if (right <= size && (table[right]->num < table[left]->num || (table[right]->num == table[left]->num && table[right]->time < table[left]->time))) {
-            min = right;
+    void submit(function<void()> task) {
+        {
+            lock_guard<mutex> lock(mtx);
+            tasks.push(move(task));
         }
-        if (table[i]->num < table[min]->num || (table[i]->num == table[min]->num && table[i]->time < table[min]->time)) return;
-        swap(table[i], table[min]);
-        reheapdown(min);
-    }
-
-    void insert(customer* cus) {
-        int id = cus->Result % capacity + 1;
-        int i = search(id);
-        if (i != -1) {
-            table[i]->num++;
-            table[i]->time = time++;
-            table[i]->q.push(cus);
-            reheapdown(i);
-            return;
-        }
-        size++;
-        table[size] = new area(id, 1);
-        table[size]->q.push(cus);
-        table[size]->time = time++;
-        reheapup(size);
+        cv.notify_one();
     }
 
-    int search(int lable) {
-        for (int i = 1; i <= size; i++) {
-            if (table[i]->label == lable) {
-                return i;
-            }
-        }
-        return -1;
+    void wait() {
+        unique_lock<mutex> lock(mtx);
+        idle.wait(lock, [this] { return tasks.empty() && !running; });
     }
+};
 
-    void remove(area* area) {
-        int i = search(area->label);
-        for (int j = 0; j < area->num; j++) {
-            customer* cus = area->q.front();
-            area->q.pop();
-            cout << cus->Result << "-" << area->label << endl;
-            delete (cus);
-        }
-        table[i] = table[size];
-        table[size] = area;
-        delete (table[size]);
-        size--;
-        reheapdown(i);
-        return;
-    }
-
-    void remove(area* area, int n) {
-        if (area->num <= n) {
-            remove(area);
-            return;
-        }
-        int i = search(area->label);
-        area->num -= n;
-        area->time = time++;
-        while (n--) {
-            customer* cus = area->q.front();
-            area->q.pop();
-            cout << cus->Result << "-" << area->label << endl;
-            delete (cus);
-        }
-        reheapup(i);
-    }
+// Drives a restaurant with Gojo's buckets split across shards. Shard s owns every
+// bucket id with id % shards == s and applies the inserts, evictions and prints
+// for those buckets from its own queue, in command order. Sukuna's heap and HAND
+// are ordered globally, so they stay on the router thread.
+//
+// Commands are handled in batches: the Huffman work of every LAPSE in the batch
+// runs in parallel, then the router walks the batch in order, routing bucket work
+// by Result, and finally the per-command output is written in input order.
+class shardedRestaurant {
+   private:
+    struct command {
+        string_view name;  // Views into the input, which outlives the run
+        string_view arg;
+        vector<string> output;  // One part per bucket for KOKUSEN
+        customer* cus;
+        handCode inorder;
+    };
 
-    vector<area*> findMin(int n) {
-        vector<area*> list;
-        vector<tempArea> temp;
-        for (int i = 1; i <= size; i++) {
-            temp.push_back({table[i], table[i]->num, table[i]->time});
-        }
-        sort(temp.begin(), temp.end(), [](const tempArea& a, const tempArea& b) {
-            return (a.num < b.num) || ((a.num == b.num) && (a.time < b.time));
-        });
-        // for (int i = 0; i < temp.size() - 1; i++) {
-        //     for (int j = 0; j < temp.size() - i - 1; j++) {
-        //         if ((temp[j].num > temp[j + 1].num) || (temp[j].num == temp[j + 1].num && temp[j].time > temp[j + 1].time)) {
-        //             swap(temp[j], temp[j + 1]);
-        //         }
-        //     }
-        // }
-        for (int i = 0; i < min(n, size); i++) {
-            list.push_back(temp[i].areaPtr);
+    restaurant* res;
+    vector<workerQueue*> shards;
+    fastModulus shardOf;  // Reduces bucket ids to a shard, like res->labelOf does Results
+    unsigned int batchSize;
+
+    workerQueue* owner(int id) { return shards[shardOf(id)]; }
+
+    void waitAll() {
+        for (auto& shard : shards) shard->wait();
+    }
+
+    void prepare(vector<command>& batch) {
+        unsigned int next = 0;
+        for (auto& c : batch) {
+            if (c.name != "LAPSE") continue;
+            command* cmd = &c;
+            const restaurant* engine = res;
+            shards[shardOf(next++)]->submit([cmd, engine] {
+                STATS(statsTimer timer(restaurantStats::LAPSE));
+                ostringstream os;
+                cmd->cus = engine->prepareLAPSE(cmd->arg, cmd->inorder, &os);
+                cmd->output[0] = os.str();
+            });
+        }
+        waitAll();
+    }
+
+    void apply(vector<command>& batch) {
+        vector<served> evicted;  // Router-side KEITEIKEN and CLEAVE results
+        for (auto& c : batch) {
+            command* cmd = &c;
+            if (c.name == "MAXSIZE") {
+                waitAll();
+                res->setMAXSIZE(parseInt(c.arg));
+            } else if (c.name == "LAPSE") {
+                customer* cus = c.cus;
+                if (cus == nullptr) continue;
+                res->lastCustomer.swap(c.inorder);
+                res->handStale = true;
+                if (cus->Result % 2) {
+                    hashBST* gojo = res->gojo;
+                    owner(res->labelOf(cus->Result) + 1)->submit([gojo, cus] { gojo->insert(cus); });
+                } else {
+                    res->sukuna->insert(cus);
+                }
+            } else if (c.name == "KOKUSEN") {
+                int maxsize = res->maxsize;
+                c.output.resize(maxsize + 1);
+                for (unsigned int s = 0; s < shards.size(); s++) {
+                    restaurant* engine = res;
+                    int first = (s == 0) ? (int)shards.size() : (int)s;
+                    shards[s]->submit([cmd, engine, first, maxsize, this] {
+                        vector<served> evicted;
+                        kokusenScratch scratch;
+                        for (int id = first; id <= maxsize; id += shards.size()) {
+                            ostringstream os;
+                            engine->KOKUSEN(id, evicted, scratch, &os);
+                            cmd->output[id] = os.str();
+                        }
+                    });
+                }
+            } else if (c.name == "KEITEIKEN") {
+                ostringstream os;
+                res->KEITEIKEN(parseInt(c.arg), evicted);
+                printKEITEIKEN(os, evicted);
+                c.output[0] = os.str();
+            } else if (c.name == "HAND") {
+                c.output[0] = res->HAND();
+            } else if (c.name == "LIMITLESS") {
+                int id = parseInt(c.arg);
+                hashBST* gojo = res->gojo;
+                owner(id)->submit([cmd, gojo, id] {
+                    vector<int> list;
+                    gojo->inorder(id, list);
+                    ostringstream os;
+                    printLIMITLESS(os, list);
+                    cmd->output[0] = os.str();
+                });
+            } else {
+                ostringstream os;
+                res->CLEAVE(parseInt(c.arg), evicted);
+                printCLEAVE(os, evicted);
+                c.output[0] = os.str();
+            }
         }
-        return list;
+        waitAll();
     }
 
-    void remove(int n) {
-        vector<area*> list = findMin(n);
-        for (auto& area : list) {
-            remove(area, n);
+    void flush(vector<command>& batch, ostream& out) {
+        for (auto& c : batch) {
+            out << c.name << "\n";
+            for (auto& part : c.output) out << part;
         }
-    }
-
-    void printPreorder(int n, int i = 1) {
-        if (i > size) return;
-        table[i]->printQueue(n);
-        printPreorder(n, i * 2);
-        printPreorder(n, i * 2 + 1);
+        out.flush();
     }
 
    public:
-    class area {
-       public:
-        int label;
-        int num;
-        int time;
-        queue<customer*> q;
-        area(int label, int num) : label(label), num(num) {}
-        ~area() {
-            while (!q.empty()) {
-                customer* cus = q.front();
-                q.pop();
-                delete (cus);
+    shardedRestaurant(restaurant* res, int count, unsigned int batchSize = 4096) : res(res), shardOf(max(count, 1)), batchSize(batchSize) {
+        for (int i = 0; i < max(count, 1); i++) {
+            shards.push_back(new workerQueue);
+        }
+    }
+    ~shardedRestaurant() {
+        for (auto& shard : shards) {
+            destroy(shard);
+        }
+    }
+
+    void run(string_view input, ostream& out) {
+        vector<command> batch;
+        size_t pos = 0;
+        while (true) {
+            string_view str = nextToken(input, pos);
+            bool more = !str.empty();
+            if (more) {
+                command c;
+                c.name = str;
+                c.output.resize(1);
+                c.cus = nullptr;
+                if (str != "KOKUSEN" && str != "HAND") c.arg = nextToken(input, pos);
+                batch.push_back(move(c));
             }
-        }
-
-        void printQueue(int n) {
-            queue<customer*> temp = q;
-            stack<customer*> st;
-            while (!temp.empty()) {
-                st.push(temp.front());
-                temp.pop();
-            }
-            while (!st.empty() && n--) {
-                customer* cus = st.top();
-                st.pop();
-                cout << label << "-" << cus->Result << "\n";
+            if (batch.size() >= batchSize || (!more && !batch.empty())) {
+                prepare(batch);
+                apply(batch);
+                flush(batch, out);
+                batch.clear();
             }
+            if (!more) return;
         }
-    };
-    struct tempArea {
-        area* areaPtr;
-        int num;
-        int time;
-    };
+    }
 };
 
-class restaurant {
-   private:
-    int maxsize;
-    hashBST* gojo;
-    minHeap* sukuna;
-    string lastCustomer;
+void restaurantInbox::submit(string_view name, string_view arg) {
+    command c;
+    c.name = name;
+    c.num = 0;
+    c.cus = nullptr;
+    if (name == "LAPSE") {
+        STATS(statsTimer timer(restaurantStats::LAPSE));
+        ostringstream os;
+        c.cus = res->prepareLAPSE(arg, c.inorder, &os);
+        c.trace = os.str();
+    } else if (name != "KOKUSEN" && name != "HAND") {
+        c.num = parseInt(arg);
+    }
+    queue.push(move(c));
+}
 
-   public:
-    struct compare {
-        bool operator()(HuffTree* l, HuffTree* r) {
-            if (l->weight() != r->weight()) {
-                return (l->weight() > r->weight());
-            }
-            return l > r;
+unsigned int restaurantInbox::drain(ostream& out, unsigned int maxBatch) {
+    batch.clear();
+    command c;
+    while (batch.size() < maxBatch && queue.pop(c)) {
+        batch.push_back(move(c));
+    }
+    res->setTrace(&out);
+    for (auto& cmd : batch) {
+        out << cmd.name << "\n";
+        if (cmd.name == "MAXSIZE") {
+            res->setMAXSIZE(cmd.num);
+        } else if (cmd.name == "LAPSE") {
+            out << cmd.trace;
+            res->admitLAPSE(cmd.cus, cmd.inorder);
+        } else if (cmd.name == "KOKUSEN") {
+            res->KOKUSEN(evicted);
+        } else if (cmd.name == "KEITEIKEN") {
+            res->KEITEIKEN(cmd.num, evicted);
+            printKEITEIKEN(out, evicted);
+        } else if (cmd.name == "HAND") {
+            out << res->HAND();
+        } else if (cmd.name == "LIMITLESS") {
+            res->LIMITLESS(cmd.num, list);
+            printLIMITLESS(out, list);
+        } else {
+            res->CLEAVE(cmd.num, evicted);
+            printCLEAVE(out, evicted);
         }
-    };
+    }
+    return batch.size();
+}
 
-    struct letter {
-        char encodeCaesar = 0;
-        int freq = 0;
-    };
+string_view nextToken(string_view input, size_t& pos) {
+    while (pos < input.size() && isspace((unsigned char)input[pos])) pos++;
+    size_t start = pos;
+    while (pos < input.size() && !isspace((unsigned char)input[pos])) pos++;
+    return input.substr(start, pos - start);
+}
 
-   public:
-    restaurant() : maxsize(0), gojo(nullptr), sukuna(nullptr), lastCustomer("") {}
-    ~restaurant() {
-        delete (gojo);
-        delete (sukuna);
-    }
-    void LAPSE(string name);
-    void KOKUSEN();
-    void KEITEIKEN(int num);
-    void HAND();
-    void LIMITLESS(int num);
-    void CLEAVE(int num);
-    void setMAXSIZE(int num) {
-        maxsize = num;
-        gojo = new hashBST(maxsize);
-        sukuna = new minHeap(maxsize);
-    }
-    char encodeCaesar(char c, int shift) {
-        if (isalpha(c)) {
-            if (isupper(c)) {
-                c = (c - 'A' + shift) % 26 + 'A';
-            } else {
-                c = (c - 'a' + shift) % 26 + 'a';
-            }
-        }
-        return c;
-    }
-    int bin2dec(string str) {
-        int num = 0;
-        for (unsigned int i = 0; i < str.length(); i++) {
-            num = (num << 1) + (str[i] - '0');
-        }
-        return num;
-    }
+// Accepts what stoi did: from_chars takes a '-' but not a leading '+'
+int parseInt(string_view s) {
+    int num = 0;
+    if (s.size() > 1 && s[0] == '+' && isdigit((unsigned char)s[1])) s.remove_prefix(1);
+    from_chars(s.data(), s.data() + s.size(), num);
+    return num;
+}
 
-    unsigned int nCr(int n, int r) {
-        if (r > n - r) r = n - r;  // C(n, r) == C(n, n - r)
-        long long ans = 1;
-        for (int i = 1; i <= r; i++) {
-            ans *= n - r + i;
-            ans /= i;
-        }
-        return ans % maxsize;
-    }
-
-    unsigned long long countWays(vector<int>& arr) {
-        int N = arr.size();
-        if (N <= 2) return 1;
-        vector<int> leftSubTree;
-        vector<int> rightSubTree;
-        int root = arr[0];
-        for (int i = 1; i < N; i++) {
-            if (arr[i] < root) leftSubTree.push_back(arr[i]);
-            else rightSubTree.push_back(arr[i]);
-        }
-        unsigned long long N1 = leftSubTree.size();
-        unsigned long long countLeft = countWays(leftSubTree);
-        unsigned long long countRight = countWays(rightSubTree);
-        return (nCr(N - 1, N1) * countLeft * countRight) % maxsize;
+void simulate(istream& ss, ostream& out, int shards) {
+    string input((istreambuf_iterator<char>(ss)), istreambuf_iterator<char>());
+    restaurant* res = new restaurant;
+    if (shards > 1) {
+        shardedRestaurant engine(res, shards);
+        engine.run(input, out);
+    } else {
+        simulate(res, input, out);
     }
+    destroy(res);
+}
+
+bool simulate(restaurant* res, istream& ss, ostream& out, commandLog* log) {
+    string input((istreambuf_iterator<char>(ss)), istreambuf_iterator<char>());
+    return simulate(res, input, out, log);
+}
 
-    unsigned long long permutePostOrder(vector<int>& list) {
-        reverse(list.begin(), list.end());
-        return countWays(list);
+// One command on res, echoed and printed the way simulate does; res's trace
+// must already point at out
+static void runCommand(restaurant* res, string_view str, string_view arg, ostream& out) {
+    // Result buffers reused by every command this thread runs
+    static thread_local vector<served> evicted;
+    static thread_local vector<int> list;
+    out << str << endl;
+    if (str == "MAXSIZE") {
+        res->setMAXSIZE(parseInt(arg));
+    } else if (str == "LAPSE") {
+        res->LAPSE(arg);
+    } else if (str == "KOKUSEN") {
+        res->KOKUSEN(evicted);
+    } else if (str == "KEITEIKEN") {
+        res->KEITEIKEN(parseInt(arg), evicted);
+        printKEITEIKEN(out, evicted);
+    } else if (str == "HAND") {
+        out << res->HAND();
+    } else if (str == "LIMITLESS") {
+        res->LIMITLESS(parseInt(arg), list);
+        printLIMITLESS(out, list);
+    } else {
+        res->CLEAVE(parseInt(arg), evicted);
+        printCLEAVE(out, evicted);
     }
-};
+}
 
-void restaurant::LAPSE(string name) {
-    int length = name.length();
-    string encode = "";
-    string encodeBin = "";
-    vector<letter> listChr;
-    unordered_map<char, letter> charFrequency;
+// Applies the commands in input to an existing restaurant, logging each one first
+// when log is given. Tokens are views into input and numbers are parsed in place,
+// so nothing here allocates per command.
+bool simulate(restaurant* res, string_view input, ostream& out, commandLog* log) {
+    res->setTrace(&out);
+    size_t pos = 0;
+    while (true) {
+        string_view str = nextToken(input, pos);
+        if (str.empty()) break;
+        string_view arg;
+        if (str != "KOKUSEN" && str != "HAND") arg = nextToken(input, pos);
+        if (log && !log->append(str, arg)) return false;
+        runCommand(res, str, arg, out);
+        if (log && !log->applied(res)) return false;
+    }
+    return true;
+}
 
-    for (char c : name) {
-        charFrequency[c].freq++;
-    }
-    for (auto& entry : charFrequency) {
-        // letter chr;
-        // chr.orig = entry.first;
-        // chr.freq = entry.second;
-        entry.second.encodeCaesar = encodeCaesar(entry.first, entry.second.freq);
-        // listChr.push_back(chr);
-    }
-
-    // for (char c : name) {
-    //     bool found = false;
-    //     for (auto& chr : listChr) {
-    //         if (chr.orig == c) {
-    //             chr.freq++;
-    //             found = true;
-    //             break;
-    //         }
-    //     }
-    //     if (!found) {
-    //         letter temp;
-    //         temp.orig = c;
-    //         temp.freq = 1;
-    //         listChr.push_back(temp);
-    //     }
-    // }
-    if (charFrequency.size() < 3) return;
-    customer* cus = new customer;
-    // for (int i = 0; i < listChr.size() - 1; i++) {
-    //     for (int j = 0; j < listChr.size() - i - 1; j++) {
-    //         if (listChr[j].freq > listChr[j + 1].freq) {
-    //             swap(listChr[j], listChr[j + 1]);
-    //         }
-    //     }
-    // }
-    // for (auto& chr : listChr) {
+void simulate(string filename, int shards) {
+    ifstream ss(filename);
+    simulate(ss, cout, shards);
+    ss.close();
+}
 
-    // }
-    for (auto& c : name) {
-        // for (auto& chr : listChr) {
-        //     if (chr.orig == c) {
-        //         encode += chr.encodeCaesar;
-        //         break;
-        //     }
-        // }
-        encode += charFrequency[c].encodeCaesar;
-    }
-    for (auto& entry : charFrequency) {
-        listChr.push_back(entry.second);
-    }
-
-    for (unsigned int i = 0; i < listChr.size() - 1; i++) {
-        for (unsigned int j = i + 1; j < listChr.size(); j++) {
-            if (listChr[i].encodeCaesar == listChr[j].encodeCaesar) {
-                listChr[i].freq += listChr[j].freq;
-                listChr.erase(listChr.begin() + j);
-                j--;
-            }
+vector<string> batchInputs(const vector<string>& paths) {
+    vector<string> inputs;
+    for (auto& path : paths) {
+        DIR* d = opendir(path.c_str());
+        if (d == nullptr) {
+            inputs.push_back(path);
+            continue;
         }
-    }
-    std::sort(listChr.begin(), listChr.end(), [](const letter& a, const letter& b) {
-        if (a.freq != b.freq) {
-            return a.freq < b.freq;
-        } else if ((a.encodeCaesar < 'a' && b.encodeCaesar < 'a') || (a.encodeCaesar >= 'a' && b.encodeCaesar >= 'a')) {
-            return a.encodeCaesar < b.encodeCaesar;
+        vector<string> found;
+        while (dirent* entry = readdir(d)) {
+            string name = entry->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".txt") == 0) found.push_back(path + "/" + name);
         }
-        return a.encodeCaesar > b.encodeCaesar;
-    });
-    priority_queue<HuffTree*, vector<HuffTree*>, compare> pq;
-    for (auto& chr : listChr) {
-        // cout << chr.encodeCaesar << " " << chr.freq << endl;
-        pq.push(new HuffTree(chr.encodeCaesar, chr.freq));
+        closedir(d);
+        sort(found.begin(), found.end());
+        inputs.insert(inputs.end(), found.begin(), found.end());
     }
-    bool unreal = false;
-    // int i = 0;
-    HuffTree *temp1, *temp2, *tree;
-    while (pq.size() > 1) {
-        temp1 = pq.top();
-        pq.pop();
-        temp2 = pq.top();
-        pq.pop();
-        tree = new HuffTree(temp1, temp2);
+    return inputs;
+}
 
-        // cout << "Iteration " << i++ << ":" << endl;
-        // cout << "sub tree 1--------------------------------------------------" << endl;
-        // temp1->printHuffmanTree(temp1->root());
-        // cout << "sub tree 2--------------------------------------------------" << endl;
-        // temp2->printHuffmanTree(temp2->root());
-        unreal = tree->rotateTree();
-        // cout << "new tree----------------------------------------------------" << endl;
-        // tree->printHuffmanTree(tree->root());
-        // cout << "------------------------------------------------------------" << endl
-        //      << endl;
+// Runs one input on a fresh restaurant. The output is collected in memory and
+// written with a single write, since simulate flushes after every command.
+static void runBatchFile(batchResult& r) {
+    auto start = chrono::steady_clock::now();
+    ostringstream out;
+    restaurant* res = new restaurant;
+    struct stat st;
+    r.ok = stat(r.input.c_str(), &st) == 0;
+    if (r.ok && st.st_size > 0) {
+        r.ok = readMapped(r.input, [&](const char* data, size_t size) {
+            simulate(res, string_view(data, size), out);
+            return true;
+        });
+    }
+    destroy(res);
+    if (r.ok) {
+        string text = out.str();
+        int fd = open(r.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        r.ok = fd >= 0 && writeAll(fd, text.data(), text.size());
+        if (fd >= 0) close(fd);
+    }
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
 
-        pq.push(tree);
-        delete (temp1);
-        delete (temp2);
+vector<batchResult> runBatch(const vector<string>& inputs, const string& outDir, int threads) {
+    vector<batchResult> results(inputs.size());
+    vector<string> names(inputs.size());
+    unordered_map<string, int> uses;
+    for (unsigned int i = 0; i < inputs.size(); i++) {
+        names[i] = inputs[i].substr(inputs[i].find_last_of('/') + 1);
+        if (names[i].size() > 4 && names[i].compare(names[i].size() - 4, 4, ".txt") == 0) names[i].resize(names[i].size() - 4);
+        uses[names[i]]++;
+    }
+    // Inputs sharing a name (a/t.txt and b/t.txt) get their 1-based position in
+    // inputs appended, so no two of them write the same file
+    unordered_set<string> outputs;
+    bool clash = false;
+    for (unsigned int i = 0; i < inputs.size(); i++) {
+        string name = names[i];
+        if (uses[name] > 1) name += "." + to_string(i + 1);
+        results[i].input = inputs[i];
+        results[i].output = outDir + "/" + name + ".out";
+        results[i].seconds = 0;
+        results[i].ok = false;
+        if (!outputs.insert(results[i].output).second) clash = true;
+    }
+    // A suffixed name can still meet another input's own name (t.txt twice next
+    // to t.2.txt). Run nothing then, rather than let one output overwrite another.
+    if (clash) return results;
+    mkdir(outDir.c_str(), 0755);
+    // Workers claim files one at a time, so a few long traces do not leave the
+    // other threads idle behind a static split
+    atomic<unsigned int> next(0);
+    auto work = [&] {
+        while (true) {
+            unsigned int i = next.fetch_add(1);
+            if (i >= results.size()) return;
+            runBatchFile(results[i]);
+        }
+    };
+    vector<thread> pool;
+    for (int t = 1; t < min(max(threads, 1), (int)results.size()); t++) {
+        pool.emplace_back(work);
     }
-    tree = pq.top();
-    pq.pop();
-    cus->tree = tree;
-    if (unreal) {
-        delete (cus);
-        return;
-    }
-    lastCustomer = "";
-    tree->getInorderTree(tree->root(), lastCustomer);
-    // print Huffman tree
-    tree->printHuffmanTree(tree->root());
-    cout << "------------------------------------------------------------" << endl;
-    unordered_map<char, string> list;
-    tree->getEncodeList(tree->root(), "", list);
-    for (int i = length - 1; i >= 0 && encodeBin.length() < 10; i--) {
-        char character = encode[i];
-        auto it = list.find(character);
-        encodeBin = it->second + encodeBin;
-    }
-    encodeBin = (encodeBin.length() > 10) ? encodeBin.substr(encodeBin.length() - 10, 10) : encodeBin;
-    reverse(encodeBin.begin(), encodeBin.end());
-    cus->Result = bin2dec(encodeBin);
-    cout << cus->Result << endl;
-    (cus->Result % 2) ? gojo->insert(cus) : sukuna->insert(cus);
+    work();
+    for (auto& t : pool) t.join();
+    return results;
 }
 
-void restaurant::KOKUSEN() {
-    vector<int> list;
-    for (int i = 1; i <= maxsize; i++) {
-        list = gojo->postorder(i);
-        // for (auto& num : list) {
-        //     cout << num << " ";
-        // }
-        if (!list.size()) continue;
-        unsigned long long numPermute = permutePostOrder(list) % maxsize;
-        if (numPermute > 0) cout << "Hoan vi: " << numPermute << "\n";
-        gojo->remove(i, numPermute);
+restaurantHost::restaurantHost(int threads, unsigned int quantum) : pending(0), quantum(max(quantum, 1u)), stopping(false) {
+    for (int i = 0; i < max(threads, 1); i++) {
+        workers.emplace_back(&restaurantHost::run, this);
     }
 }
 
-void restaurant::KEITEIKEN(int num) {
-    sukuna->remove(num);
+restaurantHost::~restaurantHost() {
+    wait();
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    work.notify_all();
+    for (auto& worker : workers) worker.join();
+    for (auto& t : tenants) {
+        destroy(t->res);
+        destroy(t);
+    }
 }
 
-void restaurant::HAND() {
-    cout << lastCustomer;
+int restaurantHost::addTenant(ostream& out) {
+    tenant* t = new tenant;
+    t->res = new restaurant;
+    t->out = &out;
+    t->scheduled = false;
+    lock_guard<mutex> lock(mtx);
+    tenants.push_back(t);
+    return tenants.size() - 1;
 }
 
-void restaurant::LIMITLESS(int num) {
-    gojo->printInorder(num);
+void restaurantHost::submit(int id, string_view name, string_view arg) {
+    command c;
+    c.name = name;
+    c.arg = arg;
+    {
+        lock_guard<mutex> lock(mtx);
+        tenant* t = tenants[id];
+        t->queue.push_back(move(c));
+        pending++;
+        if (t->scheduled) return;
+        t->scheduled = true;
+        ready.push_back(t);
+    }
+    work.notify_one();
 }
 
-void restaurant::CLEAVE(int num) {
-    sukuna->printPreorder(num);
+void restaurantHost::wait() {
+    unique_lock<mutex> lock(mtx);
+    idle.wait(lock, [this] { return pending == 0; });
 }
 
-void simulate(string filename) {
-    restaurant* res = new restaurant;
-    ifstream ss(filename);
-    string str, name, maxsize, num;
-    while (ss >> str) {
-        cout << str << endl;
-        if (str == "MAXSIZE") {
-            ss >> maxsize;
-            res->setMAXSIZE(stoi(maxsize));
-        } else if (str == "LAPSE") {
-            ss >> name;
-            res->LAPSE(name);
-        } else if (str == "KOKUSEN") {
-            res->KOKUSEN();
-        } else if (str == "KEITEIKEN") {
-            ss >> num;
-            res->KEITEIKEN(stoi(num));
-        } else if (str == "HAND") {
-            res->HAND();
-        } else if (str == "LIMITLESS") {
-            ss >> num;
-            res->LIMITLESS(stoi(num));
+// Takes the tenant at the front of the run queue, runs up to quantum of its
+// commands without the lock, then sends it to the back if it has more. A tenant
+// is never in the run queue twice, so its commands run in order on one worker
+// at a time.
+void restaurantHost::run() {
+    vector<command> batch;
+    unique_lock<mutex> lock(mtx);
+    while (true) {
+        work.wait(lock, [this] { return stopping || !ready.empty(); });
+        if (ready.empty()) return;
+        tenant* t = ready.front();
+        ready.pop_front();
+        batch.clear();
+        while (batch.size() < quantum && !t->queue.empty()) {
+            batch.push_back(move(t->queue.front()));
+            t->queue.pop_front();
+        }
+        lock.unlock();
+        t->res->setTrace(t->out);
+        for (auto& c : batch) {
+            runCommand(t->res, c.name, c.arg, *t->out);
+        }
+        lock.lock();
+        pending -= batch.size();
+        if (!t->queue.empty()) {
+            ready.push_back(t);
+            work.notify_one();
         } else {
-            ss >> num;
-            res->CLEAVE(stoi(num));
+            t->scheduled = false;
         }
+        if (pending == 0) idle.notify_all();
     }
-    ss.close();
-    delete (res);
-    return;
-}
\ No newline at end of file
+}
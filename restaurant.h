@@ -0,0 +1,1745 @@
+#ifndef RESTAURANT_H
+#define RESTAURANT_H
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <stack>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Frees p and clears the pointer, so a stale copy of it cannot be freed twice
+template <class T>
+inline void destroy(T*& p) {
+    delete p;
+    p = nullptr;
+}
+
+#ifdef RESTAURANT_STATS
+// Process-wide counters, only compiled in with -DRESTAURANT_STATS (make stats).
+// Dumped as JSON at exit to $RESTAURANT_STATS_FILE, or to stderr if unset, and
+// on demand through dump().
+class restaurantStats {
+   public:
+    enum op { MAXSIZE, LAPSE, KOKUSEN, KEITEIKEN, HAND, LIMITLESS, CLEAVE, OPS };
+    static const int BUCKETS = 40;  // Latency histogram, bucket b counts calls under 2^b ns
+
+    std::atomic<unsigned long long> calls[OPS];
+    std::atomic<unsigned long long> totalNs[OPS];
+    std::atomic<unsigned long long> histogram[OPS][BUCKETS];
+    std::atomic<unsigned long long> rotations;
+    std::atomic<unsigned long long> rejectedUnreal;      // Huffman tree flagged unreal
+    std::atomic<unsigned long long> merges;              // Huffman merge steps in LAPSE
+    std::atomic<unsigned long long> unrealFlags;         // Merges whose rotation flagged unreal
+    std::atomic<unsigned long long> unrealOverridden;    // Flags a later merge cleared again
+    std::atomic<unsigned long long> huffmanHits;         // LAPSE trees served by huffmanCache
+    std::atomic<unsigned long long> huffmanMisses;
+    std::atomic<unsigned long long> rejectedFewLetters;  // Fewer than 3 distinct letters
+    std::atomic<unsigned long long> maxBSTDepth;
+    std::atomic<unsigned long long> maxHeapSize;
+
+    static restaurantStats& instance() {
+        static restaurantStats stats;
+        return stats;
+    }
+
+    static void raise(std::atomic<unsigned long long>& mark, unsigned long long value) {
+        unsigned long long cur = mark.load(std::memory_order_relaxed);
+        while (value > cur && !mark.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    void record(op o, unsigned long long ns) {
+        calls[o].fetch_add(1, std::memory_order_relaxed);
+        totalNs[o].fetch_add(ns, std::memory_order_relaxed);
+        int b = 0;
+        while (b < BUCKETS - 1 && (1ULL << b) <= ns) b++;
+        histogram[o][b].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void dump(std::ostream& out) {
+        static const char* names[OPS] = {"MAXSIZE", "LAPSE", "KOKUSEN", "KEITEIKEN", "HAND", "LIMITLESS", "CLEAVE"};
+        out << "{\n  \"commands\": {";
+        for (int o = 0; o < OPS; o++) {
+            out << (o ? "," : "") << "\n    \"" << names[o] << "\": {\"calls\": " << calls[o] << ", \"total_ns\": " << totalNs[o] << ", \"histogram_log2_ns\": [";
+            for (int b = 0; b < BUCKETS; b++) out << (b ? ", " : "") << histogram[o][b];
+            out << "]}";
+        }
+        out << "\n  },\n  \"rotations\": " << rotations << ",\n  \"rejected_unreal\": " << rejectedUnreal;
+        out << ",\n  \"merges\": " << merges << ",\n  \"unreal_flags\": " << unrealFlags << ",\n  \"unreal_overridden\": " << unrealOverridden;
+        out << ",\n  \"huffman_hits\": " << huffmanHits << ",\n  \"huffman_misses\": " << huffmanMisses;
+        out << ",\n  \"rejected_few_letters\": " << rejectedFewLetters << ",\n  \"max_bst_depth\": " << maxBSTDepth;
+        out << ",\n  \"max_heap_size\": " << maxHeapSize << "\n}\n";
+    }
+
+   private:
+    restaurantStats() {
+        for (int o = 0; o < OPS; o++) {
+            calls[o] = 0;
+            totalNs[o] = 0;
+            for (int b = 0; b < BUCKETS; b++) histogram[o][b] = 0;
+        }
+        rotations = rejectedUnreal = merges = unrealFlags = unrealOverridden = huffmanHits = huffmanMisses = rejectedFewLetters = maxBSTDepth = maxHeapSize = 0;
+    }
+    ~restaurantStats() {
+        const char* path = getenv("RESTAURANT_STATS_FILE");
+        if (path == nullptr) {
+            dump(std::cerr);
+            return;
+        }
+        std::ofstream file(path);
+        dump(file);
+    }
+};
+
+// Times the enclosing scope as one call of a command
+class statsTimer {
+   private:
+    restaurantStats::op o;
+    std::chrono::steady_clock::time_point start;
+
+   public:
+    statsTimer(restaurantStats::op o) : o(o), start(std::chrono::steady_clock::now()) {}
+    ~statsTimer() {
+        restaurantStats::instance().record(o, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+#define STATS(stmt) stmt
+#else
+#define STATS(stmt)
+#endif
+
+// FIFO on a growable ring buffer, indexable from both ends
+template <class T>
+class ringQueue {
+   private:
+    T* buf;
+    unsigned int cap;   // Always a power of two
+    unsigned int head;  // Index of the oldest element
+    unsigned int count;
+
+    void grow() {
+        unsigned int newCap = cap ? cap * 2 : 8;
+        T* newBuf = new T[newCap];
+        for (unsigned int i = 0; i < count; i++) {
+            newBuf[i] = buf[(head + i) & (cap - 1)];
+        }
+        delete[] buf;
+        buf = newBuf;
+        cap = newCap;
+        head = 0;
+    }
+
+   public:
+    ringQueue() : buf(nullptr), cap(0), head(0), count(0) {}
+    ~ringQueue() { delete[] buf; }
+    ringQueue(const ringQueue&) = delete;
+    ringQueue& operator=(const ringQueue&) = delete;
+
+    bool empty() const { return count == 0; }
+    unsigned int size() const { return count; }
+    void push(const T& val) {
+        if (count == cap) grow();
+        buf[(head + count) & (cap - 1)] = val;
+        count++;
+    }
+    T& front() { return buf[head]; }
+    void pop() {
+        head = (head + 1) & (cap - 1);
+        count--;
+    }
+    T& operator[](unsigned int i) { return buf[(head + i) & (cap - 1)]; }      // i-th oldest
+    T& fromBack(unsigned int i) { return buf[(head + count - 1 - i) & (cap - 1)]; }  // i-th newest
+};
+
+// Huffman tree node abstract base class
+class HuffNode {
+   public:
+    virtual ~HuffNode(){};      // Base destructor
+    virtual int weight() = 0;   // Return frequency
+    virtual bool isLeaf() = 0;  // Determine type
+    virtual HuffNode* left() const { return NULL; }
+    virtual void setLeft(HuffNode* b){};
+    virtual HuffNode* right() const { return NULL; };
+    virtual void setRight(HuffNode* b){};
+    virtual void update() { return; }
+    virtual HuffNode* parent() const { return NULL; }
+    virtual void setParent(HuffNode* b){};
+    virtual char val() { return 0; }
+};
+
+// Leaf node subclass
+class LeafNode : public HuffNode {
+   private:
+    char it;  // Value
+    int wgt;  // Weight
+   public:
+    LeafNode(const char& val, int freq)  // Constructor
+    {
+        it = val;
+        wgt = freq;
+    }
+    int weight() { return wgt; }
+    char val() { return it; }
+    bool isLeaf() { return true; }
+};
+
+// Internal node subclass
+class IntlNode : public HuffNode {
+   private:
+    HuffNode* pa;
+    HuffNode* lc;  // Left child
+    HuffNode* rc;  // Right child
+    int wgt;       // Subtree weight
+   public:
+    IntlNode(HuffNode* l, HuffNode* r, HuffNode* p) {
+        wgt = l->weight() + r->weight();
+        lc = l;
+        rc = r;
+        pa = p;
+    }
+    ~IntlNode() {
+        // delete lc;
+        // delete rc;
+    }
+    int weight() { return wgt; }
+    bool isLeaf() { return false; }
+    HuffNode* left() const { return lc; }
+    void setLeft(HuffNode* b) {
+        lc = b;
+        lc->setParent(this);
+    }
+    HuffNode* right() const { return rc; }
+    void setRight(HuffNode* b) {
+        rc = b;
+        rc->setParent(this);
+    }
+    void update() { wgt = lc->weight() + rc->weight(); }
+    HuffNode* parent() const { return pa; }
+    void setParent(HuffNode* b) { pa = b; }
+};
+
+// Inorder walk of a Huffman tree as HAND prints it, kept as one int per node: a
+// leaf is ~char (always negative) and an internal node is its weight. LAPSE only
+// fills this in; the text is built when HAND actually runs.
+class handCode {
+   private:
+    std::vector<int> nodes;
+
+   public:
+    void leaf(char val) { nodes.push_back(~(int)(unsigned char)val); }
+    void internal(int weight) { nodes.push_back(weight); }
+    void clear() { nodes.clear(); }
+    void swap(handCode& other) { nodes.swap(other.nodes); }
+    unsigned int size() const { return nodes.size(); }
+    int operator[](unsigned int i) const { return nodes[i]; }
+    void push(int node) { nodes.push_back(node); }
+
+    void render(std::string& out) const {
+        out.clear();
+        char digits[12];
+        for (int node : nodes) {
+            if (node < 0) {
+                out += (char)~node;
+            } else {
+                int len = snprintf(digits, sizeof(digits), "%d", node);
+                out.append(digits, len);
+            }
+            out += '\n';
+        }
+    }
+};
+
+// Length of a Huffman code and its last 10 bits
+struct huffCode {
+    unsigned short bits;
+    int len;
+};
+
+class HuffTree {
+   private:
+    HuffNode* Root;
+
+   public:
+    int order;  // Creation order, breaks ties between equal weights
+    HuffTree(char& val, int freq, int order) : order(order) { Root = new LeafNode(val, freq); }
+    HuffTree(HuffTree* l, HuffTree* r, int order) : order(order) { Root = new IntlNode(l->root(), r->root(), this->root()); }
+    void removeHuffTree(HuffNode* node) {
+        std::stack<HuffNode*> st;
+        if (node) st.push(node);
+        while (!st.empty()) {
+            HuffNode* cur = st.top();
+            st.pop();
+            if (cur->left()) st.push(cur->left());
+            if (cur->right()) st.push(cur->right());
+            destroy(cur);
+        }
+    }
+    ~HuffTree() {}  // Destructor
+
+    HuffNode* root() { return Root; }  // Get root
+    void setRoot(HuffNode* node) { Root = node; }
+    int weight() { return Root->weight(); }  // Root weight
+    int getHight(HuffNode* root) {
+        if (root == nullptr) {
+            return 0;
+        }
+        // Recursive on purpose: getBalance calls this twice per node on every
+        // checkRotate pass, and a Huffman tree is at most 256 leaves deep
+        return std::max(getHight(root->left()), getHight(root->right())) + 1;
+    }
+
+    int getBalance(HuffNode* root) {
+        return (root == nullptr) ? 0 : (getHight(root->left()) - getHight(root->right()));
+    }
+
+    HuffNode* rotateLeft(HuffNode* root, std::ostream* trace) {
+        if (trace) *trace << "Rotate left" << std::endl;
+        STATS(restaurantStats::instance().rotations++);
+        HuffNode* temp = root->right();
+        root->setRight(temp->left());
+        temp->setLeft(root);
+        // root->update();  // No need
+        // temp->update();
+        return temp;
+    }
+
+    HuffNode* rotateRight(HuffNode* root, std::ostream* trace) {
+        if (trace) *trace << "Rotate right\n";
+        STATS(restaurantStats::instance().rotations++);
+        HuffNode* temp = root->left();
+        root->setLeft(temp->right());
+        temp->setRight(root);
+        // root->update();  // No need
+        // temp->update();
+        return temp;
+    }
+
+    void printHuffmanTree(HuffNode* root, std::ostream& out, int indent = 0) {
+        if (root == nullptr) {
+            return;
+        }
+
+        if (root->isLeaf()) {
+            LeafNode* leaf = static_cast<LeafNode*>(root);
+            out << std::string(indent, ' ') << "Leaf: " << leaf->val() << " (" << leaf->weight() << ")" << std::endl;
+        } else {
+            IntlNode* intl = static_cast<IntlNode*>(root);
+            out << std::string(indent, ' ') << "Internal Node: " << intl->weight() << " (Height: " << getHight(intl) << ")" << std::endl;
+            out << std::string(indent, ' ') << "├─ Left:" << std::endl;
+            printHuffmanTree(intl->left(), out, indent + 4);
+            out << std::string(indent, ' ') << "└─ Right:" << std::endl;
+            printHuffmanTree(intl->right(), out, indent + 4);
+        }
+    }
+
+    void getInorderTree(HuffNode* root, handCode& result) {
+        std::stack<HuffNode*> st;
+        while (root != nullptr || !st.empty()) {
+            while (root != nullptr) {
+                st.push(root);
+                root = root->left();
+            }
+            root = st.top();
+            st.pop();
+            if (root->isLeaf()) {
+                result.leaf(root->val());
+            } else {
+                result.internal(root->weight());
+            }
+            root = root->right();
+        }
+    }
+
+    HuffNode* checkRotate(HuffNode* root, bool& isRotate, bool& unreal, std::ostream* trace) {
+        if (unreal) return root;
+        if (root->isLeaf()) return root;
+        if (getBalance(root) > 1) {
+            if (getBalance(root->left()) >= 0) {
+                root = rotateRight(root, trace);
+            } else {
+                root->setLeft(rotateLeft(root->left(), trace));
+                root = rotateRight(root, trace);
+            }
+            if (root->isLeaf() && (root->right() != nullptr || root->left() != nullptr)) unreal = true;
+            isRotate = true;
+            return root;
+        } else if (getBalance(root) < -1) {
+            if (getBalance(root->right()) <= 0) {
+                root = rotateLeft(root, trace);
+            } else {
+                root->setRight(rotateRight(root->right(), trace));
+                root = rotateLeft(root, trace);
+            }
+            if (root->isLeaf() && (root->right() != nullptr || root->left() != nullptr)) unreal = true;
+            isRotate = true;
+            return root;
+        }
+        if (!isRotate) root->setLeft(checkRotate(root->left(), isRotate, unreal, trace));
+        if (!isRotate) root->setRight(checkRotate(root->right(), isRotate, unreal, trace));
+        return root;
+    }
+
+    bool rotateTree(std::ostream* trace) {
+        bool unreal = false;
+        for (int i = 0; i < 3; i++) {
+            bool isRotate = false;
+            // printHuffmanTree(Root);
+            Root = checkRotate(Root, isRotate, unreal, trace);
+            if (unreal || !isRotate) return unreal;
+        }
+        return unreal;
+    }
+
+    // Each leaf's code length and its last 10 bits (0 for a left edge, 1 for a
+    // right edge, the edge nearest the leaf lowest), stored at codes[leaf char];
+    // the Result never reads more. codes must have 256 entries.
+    void getCodes(HuffNode* root, std::vector<huffCode>& codes, huffCode code = {0, 0}) {
+        if (root == nullptr) return;
+
+        if (root->isLeaf()) {
+            codes[(unsigned char)root->val()] = code;
+        }
+        getCodes(root->left(), codes, {(unsigned short)((code.bits << 1) & 1023), code.len + 1});
+        getCodes(root->right(), codes, {(unsigned short)(((code.bits << 1) | 1) & 1023), code.len + 1});
+    }
+};
+
+// Everything LAPSE takes from a Huffman tree. The tree depends only on the sorted
+// (encoded char, frequency) list, so this is cached per thread keyed on that
+// signature. Direct-mapped: a colliding signature replaces the slot. The trace
+// text (rotations and the printed tree) is only kept once a traced LAPSE has
+// built the entry.
+class huffmanCache {
+   public:
+    struct entry {
+        std::vector<unsigned long long> signature;  // Empty for an unused slot
+        bool unreal;
+        std::vector<huffCode> codes;  // Indexed by encoded char, 256 entries once filled
+        handCode inorder;
+        bool traced;
+        std::string trace;
+    };
+
+   private:
+    static const unsigned int SLOTS = 1024;
+    std::vector<entry> slots;
+
+    entry& slotFor(const unsigned long long* signature, unsigned int count) {
+        unsigned long long h = 0;
+        for (unsigned int i = 0; i < count; i++) {
+            h = (h ^ signature[i]) * 0x9e3779b97f4a7c15ULL;
+            h ^= h >> 29;
+        }
+        return slots[h & (SLOTS - 1)];
+    }
+
+   public:
+    huffmanCache() : slots(SLOTS) {}
+
+    static huffmanCache& local() {
+        static thread_local huffmanCache cache;
+        return cache;
+    }
+
+    // nullptr unless the slot holds this signature (with its trace, if needed)
+    entry* find(const unsigned long long* signature, unsigned int count, bool needTrace) {
+        entry& e = slotFor(signature, count);
+        if (e.signature.size() != count || !std::equal(signature, signature + count, e.signature.begin())) return nullptr;
+        if (needTrace && !e.traced) return nullptr;
+        return &e;
+    }
+
+    entry& fill(const unsigned long long* signature, unsigned int count) {
+        entry& e = slotFor(signature, count);
+        e.signature.assign(signature, signature + count);
+        e.codes.assign(256, huffCode{0, 0});
+        e.inorder.clear();
+        e.traced = false;
+        e.trace.clear();
+        return e;
+    }
+};
+
+// Frees detached structures on a background thread, so dropping a whole
+// bucket or the whole restaurant costs O(1) on the caller's side
+class reclaimer {
+   private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<std::function<void()>> pending;
+    std::vector<std::function<void()>> batch;  // Worker only: the jobs being run
+    bool stopping;
+    std::thread worker;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) return;
+            // The two buffers trade places, so neither gives up its capacity
+            batch.swap(pending);
+            lock.unlock();
+            for (auto& job : batch) job();
+            batch.clear();
+            lock.lock();
+        }
+    }
+
+   public:
+    reclaimer() : stopping(false), worker(&reclaimer::run, this) {}
+    ~reclaimer() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_one();
+        worker.join();
+    }
+
+    // Joined at exit, so everything retired is freed before the process ends
+    static reclaimer& instance() {
+        static reclaimer r;
+        return r;
+    }
+
+    template <class T>
+    void retire(T* ptr) {
+        if (ptr == nullptr) return;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            pending.push_back([ptr] { delete ptr; });
+        }
+        cv.notify_one();
+    }
+};
+
+// Snapshots are a flat sequence of host-order 32-bit words, so they can be parsed
+// straight out of an mmap
+class snapshotWriter {
+   private:
+    std::string buf;
+
+   public:
+    void put(int32_t val) { buf.append(reinterpret_cast<const char*>(&val), sizeof(val)); }
+    std::string& data() { return buf; }
+};
+
+class snapshotReader {
+   private:
+    const char* cur;
+    const char* end;
+    bool ok;
+
+   public:
+    snapshotReader(const char* data, size_t size) : cur(data), end(data + size), ok(true) {}
+    int32_t get() {
+        int32_t val = 0;
+        if (end - cur < (ptrdiff_t)sizeof(val)) {
+            ok = false;
+            return 0;
+        }
+        memcpy(&val, cur, sizeof(val));
+        cur += sizeof(val);
+        return val;
+    }
+    bool good() const { return ok; }
+    bool done() const { return cur == end; }
+    // Words left, the most any count read from the data can honestly claim
+    size_t remaining() const { return (end - cur) / sizeof(int32_t); }
+};
+
+// Reduction by a divisor known only at runtime, without a hardware division.
+// 32-bit operands use Lemire's fastmod: the fraction (x * ceil(2^64 / n)) mod 2^64
+// times n, shifted down by 64, is exactly x % n. 64-bit operands use Barrett
+// reduction: x / n is estimated as the high half of x * floor((2^64 - 1) / n),
+// which is never more than two too small, and fixed up by subtraction.
+// Negative operands reduce like the built-in %, toward zero.
+class fastModulus {
+   private:
+    unsigned long long n;
+    unsigned long long m;  // floor((2^64 - 1) / n); ceil(2^64 / n) is m + 1
+
+    unsigned long long reduce(uint32_t x) const {
+        unsigned long long fraction = (m + 1) * x;
+        return (unsigned long long)(((unsigned __int128)fraction * n) >> 64);
+    }
+    unsigned long long reduce(unsigned long long x) const {
+        unsigned long long q = (unsigned long long)(((unsigned __int128)x * m) >> 64);
+        unsigned long long r = x - q * n;
+        while (r >= n) r -= n;
+        return r;
+    }
+
+   public:
+    fastModulus(int n = 1) : n(n), m(~0ULL / n) {}
+    int divisor() const { return n; }
+    template <class T>
+    T operator()(T x) const {
+        typedef typename std::conditional<sizeof(T) <= sizeof(uint32_t), uint32_t, unsigned long long>::type U;
+        if (std::is_signed<T>::value && x < 0) return -(T)reduce((U)(0 - (U)x));
+        return (T)reduce((U)x);
+    }
+};
+
+// Fixed-size blocks shared by every restaurant in the process. A thread frees
+// into and allocates from its own short list and trades blocks with the shared
+// list in batches, so most calls take no lock. Memory is carved out in chunks
+// and kept for reuse, never returned; a thread that exits strands at most two
+// batches in its list.
+template <size_t Size>
+class blockPool {
+   private:
+    struct block {
+        block* next;
+    };
+    struct localList {
+        block* head;
+        unsigned int count;
+    };
+    static const size_t BLOCK = ((Size > sizeof(block) ? Size : sizeof(block)) + 7) & ~(size_t)7;
+    static const unsigned int BATCH = 64;
+    static const unsigned int CHUNK = 4096;
+
+    std::mutex mtx;
+    block* shared;
+    std::vector<char*> chunks;  // Keeps every chunk reachable
+
+    blockPool() : shared(nullptr) {}
+
+    static localList& local() {
+        static thread_local localList list = {nullptr, 0};
+        return list;
+    }
+
+    void refill(localList& list) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (shared == nullptr) {
+            char* mem = static_cast<char*>(::operator new(BLOCK * CHUNK));
+            chunks.push_back(mem);
+            for (unsigned int i = 0; i < CHUNK; i++) {
+                block* b = reinterpret_cast<block*>(mem + i * BLOCK);
+                b->next = shared;
+                shared = b;
+            }
+        }
+        while (shared != nullptr && list.count < BATCH) {
+            block* b = shared;
+            shared = b->next;
+            b->next = list.head;
+            list.head = b;
+            list.count++;
+        }
+    }
+
+    void spill(localList& list) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (unsigned int i = 0; i < BATCH; i++) {
+            block* b = list.head;
+            list.head = b->next;
+            list.count--;
+            b->next = shared;
+            shared = b;
+        }
+    }
+
+   public:
+    // Never destroyed: the reclaimer may still be freeing blocks at exit
+    static blockPool& instance() {
+        static blockPool* pool = new blockPool;
+        return *pool;
+    }
+
+    void* allocate() {
+        localList& list = local();
+        if (list.head == nullptr) refill(list);
+        block* b = list.head;
+        list.head = b->next;
+        list.count--;
+        return b;
+    }
+
+    void release(void* p) {
+        localList& list = local();
+        block* b = static_cast<block*>(p);
+        b->next = list.head;
+        list.head = b;
+        if (++list.count >= 2 * BATCH) spill(list);
+    }
+};
+
+// Base for types allocated from blockPool. ASan builds keep the global operator
+// new so every object still gets its own redzones.
+template <class T>
+struct pooled {
+    static void* operator new(size_t size) {
+#ifdef __SANITIZE_ADDRESS__
+        return ::operator new(size);
+#else
+        static_assert(alignof(T) <= 8, "blockPool blocks are 8-byte aligned");
+        return blockPool<sizeof(T)>::instance().allocate();
+#endif
+    }
+    static void operator delete(void* p) noexcept {
+        if (p == nullptr) return;
+#ifdef __SANITIZE_ADDRESS__
+        ::operator delete(p);
+#else
+        blockPool<sizeof(T)>::instance().release(p);
+#endif
+    }
+};
+
+// LAPSE keeps nothing of the Huffman tree beyond the Result and HAND's inorder,
+// so a customer is just its Result. Customers of every restaurant share one pool.
+class customer : public pooled<customer> {
+   public:
+    int Result;
+    customer* left;
+    customer* right;
+    customer() : Result(0), left(nullptr), right(nullptr){};
+};
+
+// A customer as reported back to callers: its Result and the Gojo bucket or
+// Sukuna area it sat in
+struct served {
+    int Result;
+    int label;
+};
+
+class hashBST {
+   public:
+    // One node per customer; the node keeps its customer when the tree is
+    // restructured, so the FIFO can hold node handles
+    struct BSTNode : pooled<BSTNode> {
+        int result;
+        BSTNode *left, *right;
+        BSTNode* parent;
+        customer* cus;
+        BSTNode(int result, BSTNode* left = nullptr, BSTNode* right = nullptr, BSTNode* parent = nullptr, customer* cus = nullptr)
+            : result(result), left(left), right(right), parent(parent), cus(cus) {}
+    };
+    class BSTTree;
+
+   private:
+    int size;
+    fastModulus bucketOf;
+    std::vector<BSTTree*> table;
+
+   public:
+    bool bulkRelease;  // Hand emptied buckets to the reclaimer instead of freeing inline
+
+    hashBST(int num, bool bulkRelease = false) : size(num), bucketOf(num), bulkRelease(bulkRelease) {
+        table = std::vector<BSTTree*>(size + 1, nullptr);
+    }
+    ~hashBST() {
+        for (unsigned int i = 0; i < table.size(); i++) {
+            if (table[i] != nullptr) {
+                destroy(table[i]);
+            }
+        }
+    }
+
+    void insert(customer* cus) {
+        int id = bucketOf(cus->Result) + 1;
+        if (table[id] == nullptr) {
+            table[id] = new BSTTree;
+        }
+        table[id]->insert(cus);
+    }
+
+    void remove(int id, int n, std::vector<served>& evicted) {  // TODO: ???????
+        if (table[id]->root == nullptr) return;
+        if (bulkRelease && (unsigned int)n >= table[id]->q.size()) {
+            for (unsigned int i = 0; i < table[id]->q.size(); i++) {
+                evicted.push_back({table[id]->q[i]->result, id});
+            }
+            reclaimer::instance().retire(table[id]);
+            table[id] = nullptr;
+            return;
+        }
+        table[id]->remove(n, id, evicted);
+        if (table[id]->root == nullptr) {
+            destroy(table[id]);
+        }
+    }
+
+    // First node of node's subtree in postorder: keep descending, left first
+    static BSTNode* deepest(BSTNode* node) {
+        while (node->left != nullptr || node->right != nullptr) {
+            node = (node->left != nullptr) ? node->left : node->right;
+        }
+        return node;
+    }
+
+    // Walks the parent links instead of keeping a stack, so it allocates nothing
+    // beyond result and is safe to run on any bucket from any thread
+    void postorderTraversal(BSTNode* root, std::vector<int>& result) {
+        if (root == nullptr) return;
+        BSTNode* node = deepest(root);
+        while (true) {
+            result.push_back(node->result);
+            BSTNode* parent = node->parent;
+            if (node == root) return;
+            node = (node == parent->left && parent->right != nullptr) ? deepest(parent->right) : parent;
+        }
+    }
+
+    // Clears list and fills it with bucket id's Results in postorder
+    void postorder(int id, std::vector<int>& list) {
+        list.clear();
+        // stack<BSTNode*> st;
+        BSTTree* tree = table[id];
+        if (tree == nullptr) return;
+        postorderTraversal(tree->root, list);
+        // st.push(tree->root);
+        // while (!st.empty()) {
+        //     BSTNode* node = st.top();
+        //     st.pop();
+        //     cout << node->result << " ";
+        //     list.push_back(node->result);
+        //     if (node->left != nullptr) st.push(node->left);
+        //     if (node->right != nullptr) st.push(node->right);
+        // }
+    }
+
+    void printTree(int id) {
+        BSTTree* tree = table[id];
+        if (tree == nullptr) return;
+        printTree(tree->root, "", true);
+    }
+
+    void printTree(BSTNode* node, const std::string& prefix, bool isLeft) {
+        if (node == nullptr) return;
+
+        std::cout << prefix;
+        std::cout << (isLeft ? "├── " : "└── ");
+        std::cout << node->result << std::endl;
+
+        std::string childPrefix = prefix + (isLeft ? "│   " : "    ");
+        printTree(node->left, childPrefix, true);
+        printTree(node->right, childPrefix, false);
+    }
+
+    // Successor walk over the parent links, like postorderTraversal
+    void inorderTraversal(BSTNode* root, std::vector<int>& result) {
+        if (root == nullptr) return;
+        BSTNode* node = root;
+        while (node->left != nullptr) node = node->left;
+        while (node != nullptr) {
+            result.push_back(node->result);
+            if (node->right != nullptr) {
+                node = node->right;
+                while (node->left != nullptr) node = node->left;
+                continue;
+            }
+            BSTNode* child = node;
+            node = node->parent;
+            while (child != root && child == node->right) {
+                child = node;
+                node = node->parent;
+            }
+            if (child == root) node = nullptr;
+        }
+    }
+
+    // Per bucket: the FIFO's Results, then the BST in preorder as (result, children)
+    // pairs, children bit 0 for a left child and bit 1 for a right child
+    void save(snapshotWriter& w) {
+        for (int id = 1; id <= size; id++) {
+            BSTTree* tree = table[id];
+            if (tree == nullptr) {
+                w.put(0);
+                continue;
+            }
+            w.put(tree->q.size());
+            for (unsigned int i = 0; i < tree->q.size(); i++) {
+                w.put(tree->q[i]->result);
+            }
+            std::stack<BSTNode*> st;
+            st.push(tree->root);
+            while (!st.empty()) {
+                BSTNode* node = st.top();
+                st.pop();
+                w.put(node->result);
+                w.put((node->left ? 1 : 0) | (node->right ? 2 : 0));
+                if (node->right) st.push(node->right);
+                if (node->left) st.push(node->left);
+            }
+        }
+    }
+
+    bool load(snapshotReader& r) {
+        for (int id = 1; id <= size; id++) {
+            int count = r.get();
+            // Each customer takes a FIFO word and two node words
+            if (!r.good() || count < 0 || (size_t)count > r.remaining() / 3) return false;
+            if (count == 0) continue;
+            BSTTree* tree = new BSTTree;
+            table[id] = tree;
+            std::vector<int> fifo(count);
+            for (auto& result : fifo) result = r.get();
+            // Every customer has exactly one node, so the tree has count nodes.
+            // Equal Results lie on one downward chain, oldest on top, so preorder
+            // meets them in FIFO order.
+            std::unordered_map<int, std::queue<BSTNode*>> byResult;
+            std::stack<std::pair<BSTNode**, BSTNode*>> slots;
+            slots.push({&tree->root, nullptr});
+            for (int i = 0; i < count; i++) {
+                if (slots.empty()) return false;
+                BSTNode** slot = slots.top().first;
+                BSTNode* parent = slots.top().second;
+                slots.pop();
+                int result = r.get();
+                int children = r.get();
+                *slot = new BSTNode{result, nullptr, nullptr, parent, nullptr};
+                byResult[result].push(*slot);
+                if (children & 2) slots.push({&(*slot)->right, *slot});
+                if (children & 1) slots.push({&(*slot)->left, *slot});
+            }
+            if (!slots.empty() || !r.good()) return false;
+            for (int result : fifo) {
+                std::queue<BSTNode*>& nodes = byResult[result];
+                if (nodes.empty()) return false;
+                BSTNode* node = nodes.front();
+                nodes.pop();
+                node->cus = new customer;
+                node->cus->Result = result;
+                tree->q.push(node);
+            }
+        }
+        return true;
+    }
+
+    // Clears list and fills it with bucket id's Results in order
+    void inorder(int id, std::vector<int>& list) {
+        list.clear();
+        BSTTree* tree = table[id];
+        if (tree == nullptr) return;
+        inorderTraversal(tree->root, list);
+    }
+
+   public:
+    class BSTTree {
+       public:
+        BSTNode* root;
+        ringQueue<BSTNode*> q;  // Oldest customer first
+
+       public:
+        BSTTree() : root(nullptr) {}
+        ~BSTTree() {
+            for (unsigned int i = 0; i < q.size(); i++) {
+                destroy(q[i]->cus);
+            }
+            removeTree(root);
+        }
+        // Frees leaves bottom-up through the parent links, no stack needed
+        void removeTree(BSTNode*& root) {
+            BSTNode* node = root;
+            while (node != nullptr) {
+                if (node->left != nullptr) {
+                    node = node->left;
+                } else if (node->right != nullptr) {
+                    node = node->right;
+                } else {
+                    BSTNode* parent = (node == root) ? nullptr : node->parent;
+                    if (parent != nullptr) (parent->left == node ? parent->left : parent->right) = nullptr;
+                    destroy(node);
+                    node = parent;
+                }
+            }
+            root = nullptr;
+        }
+        // Links a node for cus under the last node on its search path and queues it
+        void insert(customer* cus) {
+            BSTNode* node = new BSTNode{cus->Result, nullptr, nullptr, nullptr, cus};
+            q.push(node);
+            if (root == nullptr) {
+                root = node;
+                return;
+            }
+            BSTNode* cur = root;
+            STATS(unsigned long long depth = 1);
+            while (true) {
+                BSTNode*& next = (cus->Result < cur->result) ? cur->left : cur->right;
+                STATS(depth++);
+                if (next == nullptr) {
+                    next = node;
+                    node->parent = cur;
+                    STATS(restaurantStats::raise(restaurantStats::instance().maxBSTDepth, depth));
+                    return;
+                }
+                cur = next;
+            }
+        }
+        void remove(unsigned int n, int label, std::vector<served>& evicted) {
+            if (n >= q.size()) {
+                while (!q.empty()) {
+                    evicted.push_back({q.front()->result, label});
+                    destroy(q.front()->cus);
+                    q.pop();
+                }
+                removeTree(root);
+                return;
+            }
+            while (n--) {
+                BSTNode* node = q.front();
+                q.pop();
+                evicted.push_back({node->result, label});
+                unlink(node);
+                destroy(node->cus);
+                destroy(node);
+            }
+        }
+        // Points whatever linked to node (its parent or root) at child instead
+        void replace(BSTNode* node, BSTNode* child) {
+            if (child != nullptr) child->parent = node->parent;
+            if (node->parent == nullptr) root = child;
+            else if (node->parent->left == node) node->parent->left = child;
+            else node->parent->right = child;
+        }
+        // Takes node out of the tree. A node with two children is replaced by its
+        // inorder successor node, which gives the same shape as copying the
+        // successor's Result up while every other node keeps its customer.
+        // Equal Results form a chain with the oldest on top, so the FIFO's oldest
+        // node is also the one a search by Result would find first.
+        void unlink(BSTNode* node) {
+            if (node->left == nullptr) {
+                replace(node, node->right);
+            } else if (node->right == nullptr) {
+                replace(node, node->left);
+            } else {
+                BSTNode* succ = node->right;
+                while (succ->left != nullptr) {
+                    succ = succ->left;
+                }
+                if (succ != node->right) {
+                    replace(succ, succ->right);
+                    succ->right = node->right;
+                    succ->right->parent = succ;
+                }
+                replace(node, succ);
+                succ->left = node->left;
+                succ->left->parent = succ;
+            }
+        }
+        customer* search(customer* root, int Result) {  // FIXME: ??????????
+            if (root == nullptr || root->Result == Result) return root;
+            if (root->Result < Result) return search(root->right, Result);
+            return search(root->left, Result);
+        }
+    };
+};
+
+// 1-indexed d-ary heap of areas ordered by (num, time). Each area's key is kept
+// packed in keys[], parallel to table[], so sifting compares without touching
+// the areas. The arity is a power of two; the restaurant uses 2 because CLEAVE
+// prints the heap in binary preorder.
+class minHeap {
+   public:
+    class area;
+    typedef unsigned long long heapKey;
+
+    // num in the high half, time in the low half, both biased so that unsigned
+    // comparison orders them as the signed ints they are. Times are unique, so
+    // keys of different areas never tie.
+    static heapKey packKey(int num, int time) {
+        return ((heapKey)((uint32_t)num ^ 0x80000000u) << 32) | ((uint32_t)time ^ 0x80000000u);
+    }
+
+   private:
+    int capacity;
+    fastModulus labelOf;
+    unsigned int time;
+    int size;
+    int shift;  // log2 of the arity
+    std::vector<area*> table;
+    std::vector<heapKey> keys;  // keys[i] is table[i]'s packed (num, time)
+    std::vector<int> slot;      // Heap index of each label's area, 0 if the label has none
+    std::vector<int> walk;      // preorder's stack, kept so repeated CLEAVEs reuse it
+    int firstChild(int i) const { return ((i - 1) << shift) + 2; }
+    int parentOf(int i) const { return ((i - 2) >> shift) + 1; }
+
+    void place(int i, area* a) {
+        table[i] = a;
+        keys[i] = packKey(a->num, a->time);
+        slot[a->label] = i;
+    }
+    void rekey(int i) { keys[i] = packKey(table[i]->num, table[i]->time); }
+    void swapSlots(int i, int j) {
+        std::swap(table[i], table[j]);
+        std::swap(keys[i], keys[j]);
+        slot[table[i]->label] = i;
+        slot[table[j]->label] = j;
+    }
+
+   public:
+    minHeap(int num, int arity = 2) : capacity(num), labelOf(num), time(0), size(0), shift(0) {
+        while ((1 << shift) < arity) shift++;
+        table = std::vector<area*>(capacity + 1, nullptr);
+        keys = std::vector<heapKey>(capacity + 1, 0);
+        slot = std::vector<int>(capacity + 1, 0);
+    };
+
+    ~minHeap() {
+        for (int i = 1; i <= size; i++) {
+            if (table[i] != nullptr) {
+                destroy(table[i]);
+            }
+        }
+    }
+
+    // The time counter, then every area in heap order with its FIFO's Results
+    void save(snapshotWriter& w) {
+        w.put((int32_t)time);
+        w.put(size);
+        for (int i = 1; i <= size; i++) {
+            area* a = table[i];
+            w.put(a->label);
+            w.put(a->num);
+            w.put(a->time);
+            w.put(a->q.size());
+            for (unsigned int j = 0; j < a->q.size(); j++) {
+                w.put(a->q[j]->Result);
+            }
+        }
+    }
+
+    bool load(snapshotReader& r) {
+        time = r.get();
+        int count = r.get();
+        if (!r.good() || count < 0 || count > capacity || (size_t)count > r.remaining() / 4) return false;
+        for (int i = 1; i <= count; i++) {
+            int label = r.get();
+            int num = r.get();
+            if (!r.good() || label < 1 || label > capacity || slot[label] != 0) return false;
+            area* a = new area(label, num);
+            a->time = r.get();
+            place(i, a);
+            size = i;
+            int length = r.get();
+            if (!r.good() || length < 0 || (size_t)length > r.remaining()) return false;
+            for (int j = 0; j < length; j++) {
+                customer* cus = new customer;
+                cus->Result = r.get();
+                a->q.push(cus);
+            }
+        }
+        return r.good();
+    }
+
+    void printHeap() {
+        for (int i = 1; i <= size; i++) {
+            std::cout << table[i]->label << " " << table[i]->num << " " << table[i]->time << std::endl;
+        }
+    }
+
+    // Only areas that were just given the newest time move up, so the full key
+    // orders them the same as comparing num alone
+    void reheapup(int i) {
+        while (i > 1) {
+            int parent = parentOf(i);
+            if (!(keys[i] < keys[parent])) return;
+            swapSlots(i, parent);
+            i = parent;
+        }
+    }
+
+    void reheapdown(int i) {
+        while (true) {
+            int first = firstChild(i);
+            if (first > size) return;
+            int last = std::min(first + (1 << shift) - 1, size);
+            int grandchild = firstChild(first);
+            if (grandchild <= size) __builtin_prefetch(&keys[grandchild]);
+            int min = first;
+            for (int c = first + 1; c <= last; c++) {
+                min = (keys[c] < keys[min]) ? c : min;
+            }
+            if (keys[i] < keys[min]) return;
+            swapSlots(i, min);
+            i = min;
+        }
+    }
+
+    void insert(customer* cus) {
+        int id = labelOf(cus->Result) + 1;
+        int i = search(id);
+        if (i != -1) {
+            table[i]->num++;
+            table[i]->time = time++;
+            table[i]->q.push(cus);
+            rekey(i);
+            reheapdown(i);
+            return;
+        }
+        size++;
+        STATS(restaurantStats::raise(restaurantStats::instance().maxHeapSize, size));
+        area* a = new area(id, 1);
+        a->q.push(cus);
+        a->time = time++;
+        place(size, a);
+        reheapup(size);
+    }
+
+    int search(int lable) { return slot[lable] ? slot[lable] : -1; }
+
+    // Moves the last area into the hole and sifts it down only; KEITEIKEN's output
+    // and CLEAVE's preorder depend on exactly this sequence of moves
+    void remove(area* area, std::vector<served>& evicted) {
+        int i = search(area->label);
+        for (int j = 0; j < area->num; j++) {
+            customer* cus = area->q.front();
+            area->q.pop();
+            evicted.push_back({cus->Result, area->label});
+            destroy(cus);
+        }
+        slot[area->label] = 0;
+        if (i != size) place(i, table[size]);
+        table[size] = nullptr;
+        size--;
+        destroy(area);
+        reheapdown(i);
+        return;
+    }
+
+    void remove(area* area, int n, std::vector<served>& evicted) {
+        if (area->num <= n) {
+            remove(area, evicted);
+            return;
+        }
+        int i = search(area->label);
+        area->num -= n;
+        area->time = time++;
+        rekey(i);
+        while (n--) {
+            customer* cus = area->q.front();
+            area->q.pop();
+            evicted.push_back({cus->Result, area->label});
+            destroy(cus);
+        }
+        reheapup(i);
+    }
+
+    // The n areas with the fewest customers, oldest first on ties. Times are
+    // unique, so a partial sort picks the same areas in the same order. The
+    // result lives in picked until the next call.
+    std::vector<area*>& findMin(int n) {
+        candidates.clear();
+        for (int i = 1; i <= size; i++) {
+            candidates.push_back({table[i], keys[i]});
+        }
+        int count = std::min(std::max(n, 0), size);
+        std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [](const tempArea& a, const tempArea& b) { return a.key < b.key; });
+        picked.clear();
+        for (int i = 0; i < count; i++) {
+            picked.push_back(candidates[i].areaPtr);
+        }
+        return picked;
+    }
+
+    // KEITEIKEN. When the batch takes every customer of every area the heap just
+    // empties, so the areas are drained in selection order without any sifting.
+    // Otherwise the selected areas are evicted one by one, because the surviving
+    // layout (which CLEAVE prints) depends on each sift; a single heapify at the
+    // end would leave a different valid heap.
+    void remove(int n, std::vector<served>& evicted) {
+        std::vector<area*>& list = findMin(n);
+        bool drainAll = (int)list.size() == size;
+        for (int i = 1; drainAll && i <= size; i++) {
+            drainAll = table[i]->num <= n;
+        }
+        if (!drainAll) {
+            for (auto& area : list) {
+                remove(area, n, evicted);
+            }
+            return;
+        }
+        for (auto& area : list) {
+            while (!area->q.empty()) {
+                evicted.push_back({area->q.front()->Result, area->label});
+                destroy(area->q.front());
+                area->q.pop();
+            }
+            slot[area->label] = 0;
+            destroy(area);
+        }
+        for (int i = 1; i <= size; i++) {
+            table[i] = nullptr;
+        }
+        size = 0;
+    }
+
+    void preorder(int n, std::vector<served>& list) {
+        walk.clear();
+        walk.push_back(1);
+        while (!walk.empty()) {
+            int cur = walk.back();
+            walk.pop_back();
+            if (cur > size) continue;
+            table[cur]->newest(n, list);
+            for (int c = firstChild(cur) + (1 << shift) - 1; c >= firstChild(cur); c--) {
+                walk.push_back(c);
+            }
+        }
+    }
+
+   public:
+    class area {
+       public:
+        int label;
+        int num;
+        int time;
+        ringQueue<customer*> q;
+        area(int label, int num) : label(label), num(num) {}
+        ~area() {
+            while (!q.empty()) {
+                customer* cus = q.front();
+                q.pop();
+                destroy(cus);
+            }
+        }
+
+        // The newest n customers, newest first; a negative n means all of them,
+        // as the original countdown never reached zero
+        void newest(int n, std::vector<served>& list) {
+            unsigned int last = (n < 0) ? q.size() : std::min((unsigned int)n, q.size());
+            for (unsigned int i = 0; i < last; i++) {
+                list.push_back({q.fromBack(i)->Result, label});
+            }
+        }
+    };
+    struct tempArea {
+        area* areaPtr;
+        heapKey key;
+    };
+
+   private:
+    std::vector<tempArea> candidates;  // findMin's scratch, kept between calls
+    std::vector<area*> picked;
+};
+
+// Reduction by a MAXSIZE known at compile time; the compiler turns the constant
+// division into a multiply and shift. Same interface as fastModulus.
+template <int N>
+struct fixedModulus {
+    fixedModulus(int) {}
+    template <class T>
+    T operator()(T x) const { return x % (T)N; }
+};
+
+// KOKUSEN's count of BST insertion orders, reduced by Mod (fastModulus or
+// fixedModulus<N>)
+template <class Mod>
+struct permuteKernel {
+    static unsigned int nCr(int n, int r, Mod mod) {
+        if (r > n - r) r = n - r;  // C(n, r) == C(n, n - r)
+        long long ans = 1;
+        for (int i = 1; i <= r; i++) {
+            ans *= n - r + i;
+            ans /= i;
+        }
+        return mod(ans);
+    }
+
+    // The N keys of arr in insertion order. The left and right subtrees are
+    // partitioned in place, in order, through tmp (N entries, reused by the
+    // recursive calls once the partition is copied back).
+    static unsigned long long countWays(int* arr, int N, int* tmp, Mod mod) {
+        if (N <= 2) return 1;
+        int root = arr[0];
+        int N1 = 0;
+        for (int i = 1; i < N; i++) {
+            if (arr[i] < root) tmp[N1++] = arr[i];
+        }
+        int k = N1;
+        for (int i = 1; i < N; i++) {
+            if (arr[i] >= root) tmp[k++] = arr[i];
+        }
+        std::copy(tmp, tmp + N - 1, arr + 1);
+        unsigned long long countLeft = countWays(arr + 1, N1, tmp, mod);
+        unsigned long long countRight = countWays(arr + 1 + N1, N - 1 - N1, tmp, mod);
+        return mod(nCr(N - 1, N1, mod) * countLeft * countRight);
+    }
+
+    // Takes the postorder list, returns the count modulo maxsize. list is
+    // reordered; scratch only grows, so a caller that keeps it allocates nothing.
+    static unsigned long long permute(std::vector<int>& list, std::vector<int>& scratch, int maxsize) {
+        Mod mod(maxsize);
+        std::reverse(list.begin(), list.end());
+        if (scratch.size() < list.size()) scratch.resize(list.size());
+        return mod(countWays(list.data(), list.size(), scratch.data(), mod));
+    }
+};
+
+typedef unsigned long long (*permuteFn)(std::vector<int>& list, std::vector<int>& scratch, int maxsize);
+
+// Buffers KOKUSEN reuses from one bucket to the next, one set per thread running it
+struct kokusenScratch {
+    std::vector<int> order;      // The bucket's postorder
+    std::vector<int> partition;  // permute's scratch
+};
+
+// Picks the permuteKernel instantiation for a MAXSIZE, falling back to the
+// Barrett reduction for sizes not in the list
+template <int... Sizes>
+struct fixedSizes;
+
+template <>
+struct fixedSizes<> {
+    static permuteFn find(int) { return &permuteKernel<fastModulus>::permute; }
+};
+
+template <int N, int... Rest>
+struct fixedSizes<N, Rest...> {
+    static permuteFn find(int n) { return (n == N) ? &permuteKernel<fixedModulus<N> >::permute : fixedSizes<Rest...>::find(n); }
+};
+
+// Build with -DRESTAURANT_MAXSIZE=N to add a deployment's size to the list
+typedef fixedSizes<
+#ifdef RESTAURANT_MAXSIZE
+    RESTAURANT_MAXSIZE,
+#endif
+    1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 16, 20, 32, 64, 100, 128, 256, 1000, 1024>
+    precompiledSizes;
+
+class restaurant {
+    friend class shardedRestaurant;
+
+   private:
+    int maxsize;
+    hashBST* gojo;
+    minHeap* sukuna;
+    permuteFn permute;  // Chosen by setMAXSIZE
+    fastModulus labelOf;
+    handCode lastCustomer;
+    handCode pendingHand;     // Scratch for LAPSE, swapped with lastCustomer on admission
+    mutable std::string handText;  // lastCustomer rendered, valid unless handStale
+    mutable bool handStale;
+    bool bulkRelease;
+    std::ostream* trace;  // Debug output (rotations, Huffman trees, Results), none if nullptr
+    kokusenScratch kokusen;  // Reused by KOKUSEN across buckets and commands
+
+   public:
+    struct compare {
+        bool operator()(HuffTree* l, HuffTree* r) {
+            if (l->weight() != r->weight()) {
+                return (l->weight() > r->weight());
+            }
+            return l->order > r->order;
+        }
+    };
+
+    struct letter {
+        char encodeCaesar = 0;
+        int freq = 0;
+    };
+
+    // Outcome of LAPSE; label is the Gojo bucket or Sukuna area the customer joined
+    struct admission {
+        bool admitted;
+        int Result;
+        int label;
+    };
+
+   public:
+    restaurant(bool bulkRelease = true) : maxsize(0), gojo(nullptr), sukuna(nullptr), permute(nullptr), handStale(false), bulkRelease(bulkRelease), trace(nullptr) {}
+    ~restaurant() { release(); }
+    // Command handlers. They print nothing; simulate formats their results.
+    // Each clears the buffer it is given and fills it, so a caller that reuses
+    // its buffers stops allocating once they have grown.
+    admission LAPSE(std::string_view name);
+    void KOKUSEN(std::vector<served>& evicted);
+    void KEITEIKEN(int num, std::vector<served>& evicted);
+    const std::string& HAND() const;
+    void LIMITLESS(int num, std::vector<int>& list);
+    void CLEAVE(int num, std::vector<served>& list);
+
+    // Pieces of LAPSE and KOKUSEN used by the sharded and queued drivers
+    customer* prepareLAPSE(std::string_view name, handCode& inorder, std::ostream* trace) const;
+    void buildHuffman(const letter* listChr, int count, huffmanCache::entry& e, std::ostream* trace) const;
+    admission admitLAPSE(customer* cus, handCode& inorder);
+    void KOKUSEN(int id, std::vector<served>& evicted, kokusenScratch& scratch, std::ostream* trace);  // Appends
+
+    void setTrace(std::ostream* os) { trace = os; }
+
+    // Full state as a binary snapshot; restore replaces the current state and
+    // leaves the restaurant empty if the data is malformed
+    std::string snapshot();
+    bool restore(const char* data, size_t size);
+    bool saveSnapshot(const std::string& path);
+    bool loadSnapshot(const std::string& path);  // Reads the file through mmap
+
+    // MAXSIZE always opens an empty Gojo and Sukuna of the new size, also on a
+    // restaurant restored from a snapshot or log; the customers seated so far
+    // are released. HAND still shows the last admitted customer.
+    void setMAXSIZE(int num) {
+        STATS(statsTimer timer(restaurantStats::MAXSIZE));
+        release();
+        maxsize = num;
+        permute = precompiledSizes::find(num);
+        labelOf = fastModulus(num);
+        gojo = new hashBST(maxsize, bulkRelease);
+        sukuna = new minHeap(maxsize);
+    }
+    char encodeCaesar(char c, int shift) const {
+        if (isalpha(c)) {
+            if (isupper(c)) {
+                c = (c - 'A' + shift) % 26 + 'A';
+            } else {
+                c = (c - 'a' + shift) % 26 + 'a';
+            }
+        }
+        return c;
+    }
+
+    unsigned long long permutePostOrder(std::vector<int>& list, std::vector<int>& scratch) const { return permute(list, scratch, maxsize); }
+
+   private:
+    // Back to a restaurant with no areas and no last customer; returns false so
+    // restore's failure paths can end with it
+    bool clear() {
+        release();
+        maxsize = 0;
+        lastCustomer.clear();
+        handText.clear();
+        handStale = false;
+        return false;
+    }
+
+    // Frees Gojo and Sukuna, on the reclaimer's thread when bulkRelease is set
+    void release() {
+        if (bulkRelease) {
+            reclaimer::instance().retire(gojo);
+            reclaimer::instance().retire(sukuna);
+            gojo = nullptr;
+            sukuna = nullptr;
+            return;
+        }
+        destroy(gojo);
+        destroy(sukuna);
+    }
+};
+
+// Output formats of the assignment
+void printKEITEIKEN(std::ostream& out, const std::vector<served>& evicted);
+void printLIMITLESS(std::ostream& out, const std::vector<int>& list);
+void printCLEAVE(std::ostream& out, const std::vector<served>& list);
+
+// Lock-free multi-producer single-consumer queue (Vyukov's node-based design).
+// push is wait-free for any number of threads; pop is only called by the one
+// consumer and may briefly miss a push that has not finished linking its node.
+template <class T>
+class mpscQueue {
+   private:
+    struct node {
+        std::atomic<node*> next;
+        T val;
+        node() : next(nullptr) {}
+    };
+    std::atomic<node*> head;  // Last pushed node, producers swap themselves in here
+    node* tail;          // Consumed sentinel, its successor is the next to pop
+
+   public:
+    mpscQueue() {
+        tail = new node;
+        head.store(tail);
+    }
+    ~mpscQueue() {
+        while (tail != nullptr) {
+            node* next = tail->next.load(std::memory_order_relaxed);
+            destroy(tail);
+            tail = next;
+        }
+    }
+    mpscQueue(const mpscQueue&) = delete;
+    mpscQueue& operator=(const mpscQueue&) = delete;
+
+    void push(T val) {
+        node* n = new node;
+        n->val = std::move(val);
+        node* prev = head.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    bool pop(T& val) {
+        node* next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) return false;
+        val = std::move(next->val);
+        destroy(tail);
+        tail = next;
+        return true;
+    }
+};
+
+// Lets any number of front-end threads feed one restaurant. Producers run the
+// Huffman part of LAPSE on their own thread and enqueue the prepared customer;
+// the single consumer drains commands in batches and applies them in queue order,
+// echoing each command like simulate does.
+class restaurantInbox {
+   public:
+    struct command {
+        std::string name;
+        int num;
+        customer* cus;
+        handCode inorder;
+        std::string trace;  // LAPSE output produced on the producer's thread
+    };
+
+   private:
+    restaurant* res;
+    mpscQueue<command> queue;
+    std::vector<command> batch;
+    std::vector<served> evicted;  // drain's result buffers, kept between batches
+    std::vector<int> list;
+
+   public:
+    restaurantInbox(restaurant* res) : res(res) {}
+    ~restaurantInbox() {
+        command c;
+        while (queue.pop(c)) {
+            destroy(c.cus);
+        }
+    }
+
+    // Thread-safe; arg is the name for LAPSE and the number for everything else
+    void submit(std::string_view name, std::string_view arg = {});
+    // Consumer only: applies up to maxBatch queued commands, writing what simulate
+    // would print to out, and returns how many ran
+    unsigned int drain(std::ostream& out, unsigned int maxBatch = 256);
+};
+
+// Write-ahead log of the commands applied to one restaurant, kept in dir as
+// "log.<generation>" next to a "checkpoint" snapshot of the same generation.
+// Records are buffered and written with one fdatasync per groupSize commands, so
+// a crash loses at most the last uncommitted group. Every checkpointEvery commands
+// the state is snapshotted and a fresh log generation starts, which bounds
+// recovery to one snapshot load plus at most checkpointEvery replayed commands.
+class commandLog {
+   private:
+    std::string dir;
+    int fd;
+    int generation;
+    std::string pending;
+    unsigned int pendingCount;
+    unsigned int sinceCheckpoint;
+    unsigned int groupSize;
+    unsigned int checkpointEvery;
+
+    std::string logPath(int gen) const { return dir + "/log." + std::to_string(gen); }
+    bool openLog(int gen, bool truncate);
+
+   public:
+    commandLog(const std::string& dir, unsigned int groupSize = 64, unsigned int checkpointEvery = 4096)
+        : dir(dir), fd(-1), generation(0), pendingCount(0), sinceCheckpoint(0), groupSize(groupSize), checkpointEvery(checkpointEvery) {}
+    ~commandLog();
+
+    // Loads the last checkpoint into a fresh res, replays the log tail and opens
+    // the log for appending; call once before append
+    bool recover(restaurant* res);
+    // False if the group this record completed could not be written and synced;
+    // the records stay pending and the next commit retries them
+    bool append(std::string_view name, std::string_view arg);
+    // Called after each applied command; checkpoints once checkpointEvery have
+    // run and returns false if that checkpoint failed
+    bool applied(restaurant* res) {
+        return ++sinceCheckpoint < checkpointEvery || checkpoint(res);
+    }
+    bool commit();
+    bool checkpoint(restaurant* res);
+};
+
+// Many independent restaurants (tenants) in one process on a shared set of
+// worker threads. Each tenant has its own MAXSIZE, command queue and output
+// stream, and its commands run in submission order on one worker at a time.
+// Tenants with queued work take turns in a round-robin run queue and hand their
+// worker back after quantum commands, so a busy tenant cannot starve the rest.
+// Customers and Gojo nodes of every tenant come from the shared blockPool, and
+// each worker's Huffman cache serves all tenants.
+class restaurantHost {
+   private:
+    struct command {
+        std::string name;
+        std::string arg;
+    };
+    struct tenant {
+        restaurant* res;
+        std::ostream* out;
+        std::deque<command> queue;
+        bool scheduled;  // In the run queue or being run by a worker
+    };
+
+    std::mutex mtx;  // Guards everything below but the workers
+    std::condition_variable work;
+    std::condition_variable idle;
+    std::vector<tenant*> tenants;
+    std::deque<tenant*> ready;        // Tenants with queued commands, in turn order
+    unsigned long long pending;  // Submitted commands that have not finished
+    unsigned int quantum;
+    bool stopping;
+    std::vector<std::thread> workers;
+
+    void run();
+
+   public:
+    restaurantHost(int threads, unsigned int quantum = 64);
+    ~restaurantHost();  // Finishes every submitted command, then frees the tenants
+    restaurantHost(const restaurantHost&) = delete;
+    restaurantHost& operator=(const restaurantHost&) = delete;
+
+    // Adds an empty restaurant printing to out, which must outlive the host, and
+    // returns its id for submit
+    int addTenant(std::ostream& out);
+    // Thread-safe; arg is the name for LAPSE and the number for everything else
+    void submit(int id, std::string_view name, std::string_view arg = {});
+    // Blocks until every command submitted so far has run
+    void wait();
+};
+
+// Runs the commands in filename, printing to cout; shards > 1 uses shardedRestaurant
+void simulate(std::string filename, int shards = 1);
+void simulate(std::istream& ss, std::ostream& out, int shards = 1);
+// With a log, these stop at the first command the log fails to take and return
+// false; the commands after it are not run
+bool simulate(restaurant* res, std::istream& ss, std::ostream& out, commandLog* log = nullptr);
+bool simulate(restaurant* res, std::string_view input, std::ostream& out, commandLog* log = nullptr);
+
+// Batch mode for regression farms: each input runs on its own restaurant, files
+// are spread over threads workers, and each output goes to outDir/<input name
+// without .txt>.out, or <name>.<position in inputs>.out when several inputs share
+// the name. Results keep the order of inputs. If two outputs would still be the
+// same file, nothing runs and every result is marked failed.
+struct batchResult {
+    std::string input;
+    std::string output;
+    double seconds;  // Reading, running and writing this file
+    bool ok;         // False if the input could not be read or the output written
+};
+std::vector<batchResult> runBatch(const std::vector<std::string>& inputs, const std::string& outDir, int threads);
+// paths with every directory replaced by the *.txt files in it, sorted by name
+std::vector<std::string> batchInputs(const std::vector<std::string>& paths);
+
+// Command stream parsing shared by the drivers: the next whitespace-separated
+// token from pos (empty at the end), and the leading integer of a token (0 if
+// there is none)
+std::string_view nextToken(std::string_view input, size_t& pos);
+int parseInt(std::string_view s);
+
+#endif